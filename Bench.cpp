@@ -0,0 +1,73 @@
+#include "Bench.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+//grow the batch until one sample takes at least this long:
+static const double TargetSampleNs = 20000.0;
+//...but don't let a batch get silly for ops that are (nearly) free:
+static const uint64_t MaxBatch = 1 << 24;
+//always take at least this many samples (so the percentiles mean something), and at most this many:
+static const size_t MinSamples = 10;
+static const size_t MaxSamples = 100000;
+
+Bench::Bench(std::ostream &out_, float min_seconds_, std::string const &filter_) : out(out_), min_seconds(min_seconds_), filter(filter_) {
+	out << "name,param,ops,ns_per_op,ops_per_s,p50_ns,p90_ns,p99_ns,min_ns,max_ns" << std::endl;
+}
+
+bool Bench::selected(std::string const &name) const {
+	return name.find(filter) != std::string::npos;
+}
+
+void Bench::run(std::string const &name, uint64_t param, Op const &op) {
+	if (!selected(name)) return;
+
+	typedef std::chrono::steady_clock Clock;
+	auto sample = [&](uint64_t batch) {
+		untimed_ns = 0.0;
+		auto before = Clock::now();
+		for (uint64_t i = 0; i < batch; ++i) {
+			op();
+		}
+		double ns = std::chrono::duration< double, std::nano >(Clock::now() - before).count();
+		return std::max(0.0, ns - untimed_ns);
+	};
+
+	//find a batch size (this also warms up caches and branch predictors):
+	uint64_t batch = 1;
+	while (batch < MaxBatch && sample(batch) < TargetSampleNs) {
+		batch *= 2;
+	}
+
+	std::vector< double > ns_per_op; //per sample
+	double total_ns = 0.0;
+	uint64_t ops = 0;
+	auto start = Clock::now();
+	while (ns_per_op.size() < MinSamples
+		|| (ns_per_op.size() < MaxSamples && std::chrono::duration< float >(Clock::now() - start).count() < min_seconds)) {
+		double ns = sample(batch);
+		ns_per_op.emplace_back(ns / double(batch));
+		total_ns += ns;
+		ops += batch;
+	}
+
+	std::sort(ns_per_op.begin(), ns_per_op.end());
+	untimed_ns = 0.0;
+	//nearest-rank percentile:
+	auto percentile = [&ns_per_op](double p) {
+		size_t rank = size_t(p * ns_per_op.size() + 0.999999);
+		return ns_per_op[std::min(ns_per_op.size(), std::max(rank, size_t(1))) - 1];
+	};
+
+	double mean = total_ns / double(ops);
+	out << name << ',' << param << ',' << ops << ',' << mean << ',' << (mean > 0.0 ? 1.0e9 / mean : 0.0)
+	    << ',' << percentile(0.50) << ',' << percentile(0.90) << ',' << percentile(0.99)
+	    << ',' << ns_per_op.front() << ',' << ns_per_op.back() << std::endl;
+}
+
+void Bench::untimed(Op const &fn) {
+	auto before = std::chrono::steady_clock::now();
+	fn();
+	untimed_ns += std::chrono::duration< double, std::nano >(std::chrono::steady_clock::now() - before).count();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <cstdint>
+
+/*
+ * Bench times small operations and writes one CSV line per benchmark:
+ *   name,param,ops,ns_per_op,ops_per_s,p50_ns,p90_ns,p99_ns,min_ns,max_ns
+ *
+ * Operations are timed in samples of 'batch' calls (batch grows until a sample takes
+ *  a few microseconds, so clock overhead doesn't swamp fast operations); the percentiles
+ *  are over the per-sample ns/op, and ns_per_op / ops_per_s are over all samples.
+ */
+
+struct Bench {
+	typedef std::function< void() > Op;
+
+	//'min_seconds' is how long to spend sampling each benchmark;
+	// only benchmarks whose name contains 'filter' are run:
+	Bench(std::ostream &out, float min_seconds = 0.5f, std::string const &filter = "");
+
+	//would run() with this name actually run?
+	bool selected(std::string const &name) const;
+
+	//time 'op' (one call is one operation) with 'param' (e.g., an object count) reported alongside.
+	void run(std::string const &name, uint64_t param, Op const &op);
+
+	//call 'fn' without counting its time toward the current op (e.g., resetting state from inside an op):
+	void untimed(Op const &fn);
+
+	std::ostream &out;
+	float min_seconds;
+	std::string filter;
+	double untimed_ns = 0.0; //time spent in untimed() during the current sample
+};
@@ -0,0 +1,260 @@
+#include "Capture.hpp"
+
+#include "gl_errors.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+Capture::Capture(std::string const &filename, glm::uvec2 const &size_, uint32_t fps, uint32_t ring_size, uint32_t max_queued_)
+	: size(size_), ring(std::max(ring_size, 1u)), max_queued(std::max(max_queued_, 1u)) {
+
+	file.open(filename.c_str(), std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open capture file '" + filename + "'.");
+	}
+	file << "YUV4MPEG2 W" << size.x << " H" << size.y << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+
+	for (Slot &slot : ring) {
+		glGenBuffers(1, &slot.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, size.x * size.y * sizeof(glm::u8vec4), nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	GL_ERRORS();
+
+	writer = std::thread(&Capture::write_frames, this);
+}
+
+Capture::~Capture() {
+	while (in_flight > 0) {
+		collect(true);
+	}
+
+	{
+		std::unique_lock< std::mutex > lock(queue_mutex);
+		quit = true;
+	}
+	queue_cv.notify_all();
+	writer.join();
+
+	for (Slot &slot : ring) {
+		glDeleteBuffers(1, &slot.buffer);
+		slot.buffer = 0;
+	}
+	GL_ERRORS();
+}
+
+void Capture::frame(GLenum read_buffer) {
+	//every slot waiting on the GPU? then the oldest one has to finish first:
+	if (in_flight == ring.size()) collect(true);
+
+	Slot &slot = ring[next_slot];
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	glReadBuffer(read_buffer);
+	//with a pack buffer bound, the last argument is an offset into it and this returns right away:
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid *)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	GL_ERRORS();
+
+	next_slot = (next_slot + 1) % ring.size();
+	in_flight += 1;
+	frames += 1;
+
+	collect(false);
+}
+
+void Capture::collect(bool wait) {
+	while (in_flight > 0) {
+		Slot &slot = ring[(next_slot + ring.size() - in_flight) % ring.size()];
+		GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GLuint64(-1) : 0);
+		if (status == GL_TIMEOUT_EXPIRED) break; //(later frames can't be done either)
+		wait = false;
+
+		//a buffer for the pixels (waiting for the writer if it is 'max_queued' frames behind):
+		Pixels pixels;
+		{
+			std::unique_lock< std::mutex > lock(queue_mutex);
+			queue_cv.wait(lock, [this](){ return queued.size() < max_queued; });
+			if (!spare.empty()) {
+				pixels = std::move(spare.back());
+				spare.pop_back();
+			}
+		}
+		pixels.resize(size.x * size.y);
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		size_t bytes = pixels.size() * sizeof(glm::u8vec4);
+		void const *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+		if (mapped) {
+			std::memcpy(pixels.data(), mapped, bytes);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		} else {
+			//(keep the video's timing: write a black frame)
+			std::cerr << "WARNING: failed to map capture buffer; frame left black." << std::endl;
+			std::fill(pixels.begin(), pixels.end(), glm::u8vec4(0x00, 0x00, 0x00, 0xff));
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+		in_flight -= 1;
+		GL_ERRORS();
+
+		{
+			std::unique_lock< std::mutex > lock(queue_mutex);
+			queued.emplace_back(std::move(pixels));
+		}
+		queue_cv.notify_all();
+	}
+}
+
+void Capture::write_frames() {
+	uint32_t chroma_size = ((size.x + 1) / 2) * ((size.y + 1) / 2);
+	std::vector< uint8_t > yuv(size.x * size.y + 2 * chroma_size);
+
+	while (true) {
+		Pixels pixels;
+		{
+			std::unique_lock< std::mutex > lock(queue_mutex);
+			queue_cv.wait(lock, [this](){ return quit || !queued.empty(); });
+			if (queued.empty()) break; //(quit, and nothing left to write)
+			pixels = std::move(queued.front());
+			queued.pop_front();
+		}
+		queue_cv.notify_all(); //(there's room in the queue now)
+
+		uint8_t *y = yuv.data();
+		uint8_t *u = y + size.x * size.y;
+		uint8_t *v = u + chroma_size;
+		rgba_to_yuv420(pixels.data(), size, y, u, v);
+		file << "FRAME\n";
+		file.write(reinterpret_cast< char const * >(yuv.data()), yuv.size());
+
+		{
+			std::unique_lock< std::mutex > lock(queue_mutex);
+			spare.emplace_back(std::move(pixels));
+		}
+	}
+
+	file.close();
+	if (file.fail()) {
+		std::cerr << "WARNING: error writing capture file." << std::endl;
+	}
+}
+
+//---- color conversion ----
+//fixed point, 14 fractional bits. Y from each pixel:
+static const int32_t YR = 4899, YG = 9617, YB = 1868; //0.299, 0.587, 0.114
+//U and V from the sum of a 2x2 block (so the coefficients are also divided by 4):
+static const int32_t UR = -691, UG = -1357, UB = 2048; //-0.168736, -0.331264, 0.5
+static const int32_t VR = 2048, VG = -1715, VB = -333; //0.5, -0.418688, -0.081312
+static const int32_t Round = 1 << 13;
+static const int32_t ChromaOffset = (128 << 14) + Round;
+
+static inline uint8_t luma(glm::u8vec4 const &px) {
+	return uint8_t((px.r * YR + px.g * YG + px.b * YB + Round) >> 14);
+}
+static inline uint8_t chroma(int32_t sr, int32_t sg, int32_t sb, int32_t cr, int32_t cg, int32_t cb) {
+	return uint8_t(std::min(255, (sr * cr + sg * cg + sb * cb + ChromaOffset) >> 14));
+}
+
+#if defined(BSNAKE_AVX2) || defined(BSNAKE_SSE2)
+//(AVX2 builds use the same 128-bit code; it's already faster than the file can be written)
+
+//two int16 coefficients, in the order _mm_madd_epi16 pairs them with unpacked values:
+static inline __m128i coefs(int32_t lo, int32_t hi) {
+	return _mm_set1_epi32(int32_t(uint32_t(uint16_t(lo)) | (uint32_t(uint16_t(hi)) << 16)));
+}
+
+//split 8 RGBA pixels (in 'a' and 'b') into 8 x int16 r, g, b:
+static inline void planar(__m128i a, __m128i b, __m128i *r, __m128i *g, __m128i *bl) {
+	__m128i mask = _mm_set1_epi32(0xff);
+	*r = _mm_packs_epi32(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+	*g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a, 8), mask), _mm_and_si128(_mm_srli_epi32(b, 8), mask));
+	*bl = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a, 16), mask), _mm_and_si128(_mm_srli_epi32(b, 16), mask));
+}
+
+//x * c0 + y * c1 + z * c2 + offset, >> 14, for 8 x int16 x, y, z (result is 8 x int16):
+static inline __m128i weigh(__m128i x, __m128i y, __m128i z, int32_t c0, int32_t c1, int32_t c2, int32_t offset) {
+	__m128i xy = coefs(c0, c1);
+	__m128i z1 = coefs(c2, 0);
+	__m128i off = _mm_set1_epi32(offset);
+	__m128i zero = _mm_setzero_si128();
+	__m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(x, y), xy), _mm_madd_epi16(_mm_unpacklo_epi16(z, zero), z1));
+	__m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(x, y), xy), _mm_madd_epi16(_mm_unpackhi_epi16(z, zero), z1));
+	lo = _mm_srai_epi32(_mm_add_epi32(lo, off), 14);
+	hi = _mm_srai_epi32(_mm_add_epi32(hi, off), 14);
+	return _mm_packs_epi32(lo, hi);
+}
+
+//sum of adjacent pairs of two rows' 16 x int16 (as halves 'a' and 'b') => 8 x int16:
+static inline __m128i block_sums(__m128i row0_a, __m128i row0_b, __m128i row1_a, __m128i row1_b) {
+	__m128i ones = _mm_set1_epi16(1);
+	return _mm_packs_epi32(
+		_mm_madd_epi16(_mm_add_epi16(row0_a, row1_a), ones),
+		_mm_madd_epi16(_mm_add_epi16(row0_b, row1_b), ones)
+	);
+}
+#endif
+
+void rgba_to_yuv420(glm::u8vec4 const *rgba, glm::uvec2 const &size, uint8_t *y, uint8_t *u, uint8_t *v) {
+	uint32_t const w = size.x;
+	uint32_t const h = size.y;
+	uint32_t const cw = (w + 1) / 2;
+
+	//two output rows (and one row of chroma) at a time; rows are flipped, since 'rgba' starts at the bottom:
+	for (uint32_t oy = 0; oy < h; oy += 2) {
+		uint32_t const oy1 = std::min(oy + 1, h - 1); //(odd height: last row pairs with itself)
+		glm::u8vec4 const *src0 = rgba + size_t(h - 1 - oy) * w;
+		glm::u8vec4 const *src1 = rgba + size_t(h - 1 - oy1) * w;
+		uint8_t *y0 = y + size_t(oy) * w;
+		uint8_t *y1 = y + size_t(oy1) * w;
+		uint8_t *u_row = u + size_t(oy / 2) * cw;
+		uint8_t *v_row = v + size_t(oy / 2) * cw;
+
+		uint32_t x = 0;
+#if defined(BSNAKE_AVX2) || defined(BSNAKE_SSE2)
+		//16 pixels (8 chroma samples) at a time:
+		for (; x + 16 <= w; x += 16) {
+			__m128i const *p0 = reinterpret_cast< __m128i const * >(src0 + x);
+			__m128i const *p1 = reinterpret_cast< __m128i const * >(src1 + x);
+			__m128i r0a, g0a, b0a, r0b, g0b, b0b, r1a, g1a, b1a, r1b, g1b, b1b;
+			planar(_mm_loadu_si128(p0 + 0), _mm_loadu_si128(p0 + 1), &r0a, &g0a, &b0a);
+			planar(_mm_loadu_si128(p0 + 2), _mm_loadu_si128(p0 + 3), &r0b, &g0b, &b0b);
+			planar(_mm_loadu_si128(p1 + 0), _mm_loadu_si128(p1 + 1), &r1a, &g1a, &b1a);
+			planar(_mm_loadu_si128(p1 + 2), _mm_loadu_si128(p1 + 3), &r1b, &g1b, &b1b);
+
+			_mm_storeu_si128(reinterpret_cast< __m128i * >(y0 + x), _mm_packus_epi16(
+				weigh(r0a, g0a, b0a, YR, YG, YB, Round), weigh(r0b, g0b, b0b, YR, YG, YB, Round)));
+			_mm_storeu_si128(reinterpret_cast< __m128i * >(y1 + x), _mm_packus_epi16(
+				weigh(r1a, g1a, b1a, YR, YG, YB, Round), weigh(r1b, g1b, b1b, YR, YG, YB, Round)));
+
+			__m128i sr = block_sums(r0a, r0b, r1a, r1b);
+			__m128i sg = block_sums(g0a, g0b, g1a, g1b);
+			__m128i sb = block_sums(b0a, b0b, b1a, b1b);
+			__m128i cu = weigh(sr, sg, sb, UR, UG, UB, ChromaOffset);
+			__m128i cv = weigh(sr, sg, sb, VR, VG, VB, ChromaOffset);
+			_mm_storel_epi64(reinterpret_cast< __m128i * >(u_row + x / 2), _mm_packus_epi16(cu, cu));
+			_mm_storel_epi64(reinterpret_cast< __m128i * >(v_row + x / 2), _mm_packus_epi16(cv, cv));
+		}
+#endif
+		//the rest (or all, without SIMD) one pixel / chroma sample at a time:
+		for (uint32_t px = x; px < w; ++px) {
+			y0[px] = luma(src0[px]);
+			y1[px] = luma(src1[px]);
+		}
+		for (uint32_t cx = x / 2; cx < cw; ++cx) {
+			uint32_t const x0 = 2 * cx;
+			uint32_t const x1 = std::min(x0 + 1, w - 1); //(odd width: last column pairs with itself)
+			int32_t sr = src0[x0].r + src0[x1].r + src1[x0].r + src1[x1].r;
+			int32_t sg = src0[x0].g + src0[x1].g + src1[x0].g + src1[x1].g;
+			int32_t sb = src0[x0].b + src0[x1].b + src1[x0].b + src1[x1].b;
+			u_row[cx] = chroma(sr, sg, sb, UR, UG, UB);
+			v_row[cx] = chroma(sr, sg, sb, VR, VG, VB);
+		}
+	}
+}
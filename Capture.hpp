@@ -0,0 +1,72 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Capture records every frame to an uncompressed Y4M video (4:2:0, full-range BT.601, i.e. "C420jpeg"),
+ *  which ffmpeg and most players read directly.
+ *
+ * frame() starts an asynchronous glReadPixels of the just-drawn frame into the next pixel buffer
+ *  of a small ring, and hands the oldest finished buffers to a writer thread, which converts
+ *  RGBA to YUV (SSE2 where available) and writes them out.
+ *
+ * Frames are never dropped: if the GPU is a whole ring behind, or the writer has 'max_queued'
+ *  frames waiting, frame() waits for them.
+ *
+ * Create and destroy with the GL context current; the destructor writes every frame captured so far.
+ * NOTE: constructor throws if the file can't be opened
+ */
+
+struct Capture {
+	Capture(std::string const &filename, glm::uvec2 const &size, uint32_t fps, uint32_t ring_size = 3, uint32_t max_queued = 8);
+	~Capture();
+	Capture(Capture const &) = delete;
+	Capture &operator=(Capture const &) = delete;
+
+	//read back the lower-left 'size' pixels of 'read_buffer' of the bound read framebuffer
+	// (e.g., GL_BACK of the window, just before swapping) as the next frame:
+	void frame(GLenum read_buffer);
+
+	glm::uvec2 size;
+	uint32_t frames = 0; //frames captured so far
+
+	//----- main thread -----
+	struct Slot {
+		GLuint buffer = 0; //GL_PIXEL_PACK_BUFFER
+		GLsync fence = 0; //0 => not in flight
+	};
+	std::vector< Slot > ring;
+	uint32_t next_slot = 0; //slot the next frame reads into
+	uint32_t in_flight = 0; //slots (before next_slot) waiting on the GPU
+
+	//hand the oldest in-flight frames to the writer; 'wait' => wait for at least the oldest one:
+	void collect(bool wait);
+
+	//----- shared with writer thread -----
+	typedef std::vector< glm::u8vec4 > Pixels;
+	uint32_t max_queued;
+	std::deque< Pixels > queued; //frames waiting to be written (lower-left origin)
+	std::vector< Pixels > spare; //written frames, for reuse
+	bool quit = false;
+	std::mutex queue_mutex;
+	std::condition_variable queue_cv;
+
+	//----- writer thread -----
+	std::ofstream file;
+	std::thread writer;
+	void write_frames();
+};
+
+//convert a lower-left-origin RGBA image to top-down 4:2:0 planes (full-range BT.601; alpha ignored).
+// 'y' gets size.x * size.y bytes, 'u' and 'v' get ((size.x+1)/2) * ((size.y+1)/2) each:
+void rgba_to_yuv420(glm::u8vec4 const *rgba, glm::uvec2 const &size, uint8_t *y, uint8_t *u, uint8_t *v);
@@ -0,0 +1,45 @@
+#include "CircleProgram.hpp"
+
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+
+CircleProgram::CircleProgram() {
+	program = gl_compile_program(
+		//vertex shader:
+		"#version 330\n"
+		"uniform mat4 OBJECT_TO_CLIP;\n"
+		"in vec2 Corner;\n"
+		"in vec2 Center;\n"
+		"in float Radius;\n"
+		"in vec4 Color;\n"
+		"out vec4 color;\n"
+		"void main() {\n"
+		"	gl_Position = OBJECT_TO_CLIP * vec4(Center + Radius * Corner, 0.0, 1.0);\n"
+		"	color = Color;\n"
+		"}\n"
+	,
+		//fragment shader:
+		"#version 330\n"
+		"in vec4 color;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	fragColor = color;\n"
+		"}\n"
+	);
+
+	//look up the locations of vertex attributes:
+	Corner_vec2 = glGetAttribLocation(program, "Corner");
+	Center_vec2 = glGetAttribLocation(program, "Center");
+	Radius_float = glGetAttribLocation(program, "Radius");
+	Color_vec4 = glGetAttribLocation(program, "Color");
+
+	//look up the locations of uniforms:
+	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
+
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+}
+
+CircleProgram::~CircleProgram() {
+	glDeleteProgram(program);
+	program = 0;
+}
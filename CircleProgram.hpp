@@ -0,0 +1,20 @@
+#pragma once
+
+#include "GL.hpp"
+
+//Shader program that draws instanced solid circles:
+// a unit-circle mesh (Corner) is scaled by each instance's Radius, moved to its Center, and tinted with its Color.
+struct CircleProgram {
+	CircleProgram();
+	~CircleProgram();
+
+	GLuint program = 0;
+	//Attribute (per-vertex variable) locations:
+	GLuint Corner_vec2 = -1U;
+	//Attribute (per-instance variable) locations:
+	GLuint Center_vec2 = -1U;
+	GLuint Radius_float = -1U;
+	GLuint Color_vec4 = -1U;
+	//Uniform (per-invocation variable) locations:
+	GLuint OBJECT_TO_CLIP_mat4 = -1U;
+};
@@ -0,0 +1,22 @@
+#include "CircleView.hpp"
+
+#include <algorithm>
+
+void CircleView::cull(SnakeSim const &sim, glm::vec2 const &min_, glm::vec2 const &max_) {
+	min = min_;
+	max = max_;
+
+	//obstacles and food are looked up in the sim's grids (growing the box by the largest radius each holds):
+	obstacles.clear();
+	sim.obstacle_grid.for_each(min - glm::vec2(sim.obs_r_max), max + glm::vec2(sim.obs_r_max), [&](uint32_t o) {
+		if (contains(sim.obstacles.pos(o), sim.obstacles.r[o])) obstacles.emplace_back(o);
+	});
+	//(grid order is arbitrary; sort so overlapping obstacles layer the same way every frame)
+	std::sort(obstacles.begin(), obstacles.end());
+
+	foods.clear();
+	sim.foods.grid.for_each(min - glm::vec2(sim.food_r), max + glm::vec2(sim.food_r), [&](uint32_t f) {
+		glm::vec3 const &food = sim.foods[f];
+		if (contains(glm::vec2(food.x, food.y), food.z)) foods.emplace_back(f);
+	});
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "SnakeSim.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/*
+ * CircleView is the CPU side of drawing a SnakeSim's circles: which obstacles and food
+ *  overlap the view rectangle, looked up in the sim's grids. It has no GL in it, so
+ *  SnakeMode::draw and bsnake-bench share it.
+ */
+
+//one circle to draw (the per-instance attributes of SnakeMode's circle programs):
+struct CircleInstance {
+	CircleInstance(glm::vec2 const &Center_, float Radius_, glm::u8vec4 const &Color_) :
+		Center(Center_), Radius(Radius_), Color(Color_) { }
+	glm::vec2 Center;
+	float Radius;
+	glm::u8vec4 Color;
+};
+static_assert(sizeof(CircleInstance) == 4*2 + 4 + 1*4, "CircleInstance should be packed");
+
+struct CircleView {
+	//find what's in the box [min_, max_] (replacing what was found before):
+	void cull(SnakeSim const &sim, glm::vec2 const &min_, glm::vec2 const &max_);
+
+	//does a circle overlap the box?
+	bool contains(glm::vec2 const &center, float radius) const {
+		return center.x + radius >= min.x && center.x - radius <= max.x
+		    && center.y + radius >= min.y && center.y - radius <= max.y;
+	}
+
+	glm::vec2 min = glm::vec2(0.0f);
+	glm::vec2 max = glm::vec2(0.0f);
+	//(kept between calls so they don't reallocate every frame)
+	std::vector< uint32_t > obstacles; //indices into sim.obstacles, in increasing order
+	std::vector< uint32_t > foods; //indices into sim.foods
+};
@@ -0,0 +1,40 @@
+#include "FoodPool.hpp"
+
+#include <cassert>
+
+FoodPool::FoodPool(uint32_t capacity_, SpatialGrid const &layout) : capacity(capacity_), grid(layout) {
+	foods.reserve(capacity);
+	serials.reserve(capacity);
+	grid.clear();
+	grid.reserve(capacity);
+}
+
+void FoodPool::add(glm::vec2 const &at, float r) {
+	assert(!full());
+	grid.insert(size(), at);
+	foods.emplace_back(at, r);
+	serials.emplace_back(next_serial++);
+}
+
+void FoodPool::remove(uint32_t i) {
+	assert(i < size());
+	uint32_t last = size() - 1;
+	grid.erase(i);
+	if (i != last) {
+		foods[i] = foods[last];
+		serials[i] = serials[last];
+		grid.relabel(last, i);
+	}
+	foods.pop_back();
+	serials.pop_back();
+}
+
+uint32_t FoodPool::oldest() const {
+	assert(!foods.empty());
+	uint32_t ret = 0;
+	for (uint32_t i = 1; i < size(); ++i) {
+		//NOTE: compare via difference so this stays correct if next_serial wraps:
+		if (int32_t(serials[i] - serials[ret]) < 0) ret = i;
+	}
+	return ret;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "SpatialGrid.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/*
+ * FoodPool holds up to 'capacity' foods in contiguous storage, bucketed in a SpatialGrid.
+ * All storage is allocated up front, so adding and eating food never allocates.
+ * Removal swaps the last food into the hole, so food order is not meaningful.
+ */
+
+struct FoodPool {
+	//what SnakeSim does when it is time to spawn food but the pool is full:
+	enum Policy : uint8_t {
+		StopSpawning, //skip the spawn
+		DespawnOldest, //remove the longest-lived food to make room
+	};
+
+	FoodPool() = default;
+	//'layout' is an (empty) grid giving the cells to bucket food into:
+	FoodPool(uint32_t capacity, SpatialGrid const &layout);
+
+	uint32_t size() const { return uint32_t(foods.size()); }
+	bool full() const { return foods.size() >= capacity; }
+	glm::vec3 const &operator[](uint32_t i) const { return foods[i]; }
+	std::vector< glm::vec3 >::const_iterator begin() const { return foods.begin(); }
+	std::vector< glm::vec3 >::const_iterator end() const { return foods.end(); }
+
+	//add a food at 'at' with radius 'r' (pool must not be full):
+	void add(glm::vec2 const &at, float r);
+	//remove food 'i' by swapping the last food into its slot:
+	void remove(uint32_t i);
+	//index of the food that was added longest ago (pool must not be empty):
+	// (linear scan; only needed when spawning into a full pool)
+	uint32_t oldest() const;
+
+	uint32_t capacity = 0;
+	std::vector< glm::vec3 > foods; //(x, y, r)
+	std::vector< uint32_t > serials; //per food: spawn order, for 'oldest'
+	uint32_t next_serial = 0;
+	SpatialGrid grid; //ids are indices into 'foods'
+};
@@ -0,0 +1,183 @@
+#include "Headless.hpp"
+
+#include "gl_errors.hpp"
+
+#ifdef __linux__
+//(surfaceless rendering never touches X11, so skip Xlib's types in eglplatform.h)
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <dlfcn.h>
+#endif
+
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+
+//libEGL is opened the first time a Headless is created, instead of being linked,
+// so the windowed game runs on machines without it (egl::Name is eglName):
+namespace egl {
+	#define EGL_FUNCTIONS( X ) \
+		X( GetProcAddress ) \
+		X( GetDisplay ) \
+		X( Initialize ) \
+		X( Terminate ) \
+		X( GetError ) \
+		X( BindAPI ) \
+		X( ChooseConfig ) \
+		X( CreateContext ) \
+		X( DestroyContext ) \
+		X( MakeCurrent )
+
+	#define DECLARE( NAME ) static decltype(&::egl ## NAME) NAME = nullptr;
+	EGL_FUNCTIONS( DECLARE )
+	#undef DECLARE
+
+	static void load() {
+		static void *library = nullptr;
+		if (library) return;
+		library = dlopen("libEGL.so.1", RTLD_NOW | RTLD_LOCAL);
+		if (!library) library = dlopen("libEGL.so", RTLD_NOW | RTLD_LOCAL);
+		if (!library) {
+			throw std::runtime_error(std::string("Headless rendering needs libEGL, which failed to load (") + dlerror() + ").");
+		}
+		#define LOAD( NAME ) \
+			NAME = reinterpret_cast< decltype(&::egl ## NAME) >(dlsym(library, "egl" #NAME)); \
+			if (!NAME) throw std::runtime_error("libEGL has no egl" #NAME "().");
+		EGL_FUNCTIONS( LOAD )
+		#undef LOAD
+	}
+
+	#undef EGL_FUNCTIONS
+}
+
+Headless::Headless(glm::uvec2 const &size_) : size(size_) {
+	egl::load();
+
+	//prefer Mesa's surfaceless platform (no display server needed at all); fall back to the default display:
+	EGLDisplay egl_display = EGL_NO_DISPLAY;
+	auto get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)egl::GetProcAddress("eglGetPlatformDisplayEXT");
+	if (get_platform_display) {
+		egl_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (egl_display == EGL_NO_DISPLAY) {
+		egl_display = egl::GetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	if (egl_display == EGL_NO_DISPLAY || !egl::Initialize(egl_display, nullptr, nullptr)) {
+		throw std::runtime_error("Failed to initialize an EGL display for headless rendering.");
+	}
+
+	//(the destructor doesn't run if the constructor throws, so clean up by hand; terminating frees the context too)
+	auto fail = [&](std::string const &what) {
+		EGLint error = egl::GetError();
+		egl::Terminate(egl_display);
+		throw std::runtime_error("Failed to " + what + " for headless rendering (EGL error " + std::to_string(error) + ").");
+	};
+
+	if (!egl::BindAPI(EGL_OPENGL_API)) fail("bind the OpenGL API");
+
+	//Ask for an OpenGL context version 3.3, core profile (same as the window's):
+	// (there's no surface, so any config will do -- or none, with EGL_KHR_no_config_context)
+	EGLConfig config = EGL_NO_CONFIG_KHR;
+	{
+		EGLint const config_attribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+		EGLint count = 0;
+		if (!egl::ChooseConfig(egl_display, config_attribs, &config, 1, &count) || count == 0) {
+			config = EGL_NO_CONFIG_KHR;
+		}
+	}
+	EGLint const context_attribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+#ifndef NDEBUG
+		EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+#endif
+		EGL_NONE
+	};
+	EGLContext egl_context = egl::CreateContext(egl_display, config, EGL_NO_CONTEXT, context_attribs);
+	if (egl_context == EGL_NO_CONTEXT) fail("create an OpenGL 3.3 core context");
+	if (!egl::MakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)) fail("make the (surfaceless) context current");
+
+	display = egl_display;
+	context = egl_context;
+
+	//framebuffer to draw into, with the same formats as the window's:
+	glGenRenderbuffers(1, &color_renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, color_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+
+	glGenRenderbuffers(1, &depth_stencil_renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_stencil_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.x, size.y);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_renderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_stencil_renderbuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &color_renderbuffer);
+		glDeleteRenderbuffers(1, &depth_stencil_renderbuffer);
+		egl::MakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		egl::Terminate(egl_display);
+		throw std::runtime_error("Headless framebuffer is incomplete (status " + std::to_string(status) + ").");
+	}
+
+	glViewport(0, 0, size.x, size.y);
+
+	GL_ERRORS();
+}
+
+Headless::~Headless() {
+	if (!display) return;
+	EGLDisplay egl_display = display;
+
+	glDeleteFramebuffers(1, &framebuffer);
+	framebuffer = 0;
+	glDeleteRenderbuffers(1, &color_renderbuffer);
+	color_renderbuffer = 0;
+	glDeleteRenderbuffers(1, &depth_stencil_renderbuffer);
+	depth_stencil_renderbuffer = 0;
+
+	egl::MakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	egl::DestroyContext(egl_display, context);
+	context = nullptr;
+	egl::Terminate(egl_display);
+	display = nullptr;
+}
+
+void Headless::read_pixels(glm::u8vec4 *data) {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	GL_ERRORS();
+}
+
+void *Headless::get_proc_address(char const *name) {
+	if (!egl::GetProcAddress) return nullptr; //(no Headless yet, so no EGL)
+	return reinterpret_cast< void * >(egl::GetProcAddress(name));
+}
+
+#else //no EGL here
+
+Headless::Headless(glm::uvec2 const &size_) : size(size_) {
+	throw std::runtime_error("Headless rendering needs EGL, which is only set up on Linux.");
+}
+
+Headless::~Headless() {
+}
+
+void Headless::read_pixels(glm::u8vec4 *data) {
+}
+
+void *Headless::get_proc_address(char const *name) {
+	return nullptr;
+}
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+/*
+ * Headless is an OpenGL 3.3 core context with no window: an EGL surfaceless context
+ *  (e.g., Mesa llvmpipe on a machine with no display or GPU) drawing into a framebuffer object.
+ *
+ * The constructor makes the context current and leaves the framebuffer bound (with the viewport
+ *  covering it), so anything that draws to "the screen" -- e.g., Mode::draw -- draws into it.
+ * There is no vsync or compositor, so frames go as fast as the rasterizer allows.
+ *
+ * Only available on Linux (needs libEGL with EGL_MESA_platform_surfaceless or a default display,
+ *  plus EGL_KHR_surfaceless_context). libEGL is loaded at run time by the first Headless, so only --headless needs it.
+ * NOTE: constructor throws on error
+ */
+
+struct Headless {
+	Headless(glm::uvec2 const &size);
+	~Headless();
+	Headless(Headless const &) = delete;
+	Headless &operator=(Headless const &) = delete;
+
+	//copy the framebuffer's pixels to 'data' (size.x * size.y pixels, lower-left origin):
+	void read_pixels(glm::u8vec4 *data);
+
+	//look up a GL entry point (e.g., for init_gl_debug_output):
+	static void *get_proc_address(char const *name);
+
+	glm::uvec2 size;
+
+	GLuint framebuffer = 0;
+	GLuint color_renderbuffer = 0; //RGBA8
+	GLuint depth_stencil_renderbuffer = 0; //DEPTH24_STENCIL8 (like the window's)
+
+	//EGL handles (void * so this header doesn't need EGL's):
+	void *display = nullptr;
+	void *context = nullptr;
+};
@@ -20,6 +20,13 @@ struct Mode : std::enable_shared_from_this< Mode > {
 	//draw is called after update:
 	virtual void draw(glm::uvec2 const &drawable_size) = 0;
 
+	//fixed-step mode: if 'tick' is nonzero, the main loop calls update(tick) zero or more times per frame
+	// (so simulated time keeps pace with real time) instead of once with the measured elapsed time.
+	//'tick_alpha' is then the fraction of a tick left over when draw is called (in [0,1)),
+	// which draw can use to interpolate between the last two updates:
+	float tick = 0.0f;
+	float tick_alpha = 1.0f;
+
 	//Mode::current is the Mode to which events are dispatched.
 	// use 'set_current' to change the current Mode (e.g., to switch to a menu)
 	static std::shared_ptr< Mode > current;
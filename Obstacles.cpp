@@ -0,0 +1,110 @@
+#include "Obstacles.hpp"
+
+#include "simd.hpp"
+
+#include <cmath>
+#include <cassert>
+
+void Obstacles::push_back(glm::vec2 const &pos, float r_, glm::vec2 const &dest) {
+	x.emplace_back(pos.x);
+	y.emplace_back(pos.y);
+	r.emplace_back(r_);
+	dest_x.emplace_back(dest.x);
+	dest_y.emplace_back(dest.y);
+	mv_timer.emplace_back(0.0f);
+}
+
+void Obstacles::clear() {
+	x.clear();
+	y.clear();
+	r.clear();
+	dest_x.clear();
+	dest_y.clear();
+	mv_timer.clear();
+}
+
+//---- scalar versions (also used for the tails of the SIMD loops) ----
+
+static inline bool collide_one(float cx, float cy, float cr, float ox, float oy, float or_) {
+	float dx = cx - ox;
+	float dy = cy - oy;
+	return dx * dx + dy * dy < 0.9f * (cr + or_) * (cr + or_);
+}
+
+bool Obstacles::any_collide(uint32_t const *ids, uint32_t count, glm::vec2 const &center, float radius) const {
+	using namespace simd;
+	const uint32_t W = Lanes::Width;
+	uint32_t i = 0;
+
+	if (W > 1) {
+		Lanes cx(center.x), cy(center.y), cr(radius), scale(0.9f);
+		for (; i + W <= count; i += W) {
+			Lanes dx = cx - gather(x.data(), ids + i);
+			Lanes dy = cy - gather(y.data(), ids + i);
+			Lanes rs = cr + gather(r.data(), ids + i);
+			Lanes d2 = dx * dx + dy * dy;
+			if (bits(d2 < scale * rs * rs)) return true;
+		}
+	}
+
+	for (; i < count; ++i) {
+		uint32_t id = ids[i];
+		if (collide_one(center.x, center.y, radius, x[id], y[id], r[id])) return true;
+	}
+	return false;
+}
+
+void Obstacles::step(float elapsed, float rate_mod, float step_sq, std::vector< uint32_t > *moved, std::vector< uint32_t > *arrived) {
+	assert(moved && arrived);
+	uint32_t count = size();
+	uint32_t i = 0;
+
+	//NOTE: the SIMD path uses the same operations in the same order as the scalar path,
+	// so results are bit-identical whichever one runs.
+	using namespace simd;
+	const uint32_t W = Lanes::Width;
+	if (W > 1) {
+		Lanes e(elapsed), mod(rate_mod), st(step_sq);
+		for (; i + W <= count; i += W) {
+			Lanes rs = load(r.data() + i);
+			Lanes t = load(mv_timer.data() + i) + e;
+			Mask fire = t > rs * mod;
+			store(mv_timer.data() + i, select(fire, t - rs, t));
+			if (!bits(fire)) continue;
+
+			Lanes px = load(x.data() + i);
+			Lanes py = load(y.data() + i);
+			Lanes dx = load(dest_x.data() + i) - px;
+			Lanes dy = load(dest_y.data() + i) - py;
+			Lanes d2 = dx * dx + dy * dy;
+			Mask near = d2 < st;
+			Mask go = and_not(fire, near);
+			Lanes s = st / sqrt(d2);
+			store(x.data() + i, select(go, px + dx * s, px));
+			store(y.data() + i, select(go, py + dy * s, py));
+
+			for (uint32_t go_bits = bits(go), arrive_bits = bits(near & fire), b = 0; b < W; ++b) {
+				if (go_bits & (1u << b)) moved->emplace_back(i + b);
+				if (arrive_bits & (1u << b)) arrived->emplace_back(i + b);
+			}
+		}
+	}
+
+	for (; i < count; ++i) {
+		mv_timer[i] += elapsed;
+		if (mv_timer[i] > r[i] * rate_mod) {
+			mv_timer[i] -= r[i];
+			float dx = dest_x[i] - x[i];
+			float dy = dest_y[i] - y[i];
+			float dist_sq = dx * dx + dy * dy;
+			if (dist_sq < step_sq) {
+				arrived->emplace_back(i);
+			} else {
+				float scaling = step_sq / std::sqrt(dist_sq);
+				x[i] += dx * scaling;
+				y[i] += dy * scaling;
+				moved->emplace_back(i);
+			}
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "aligned_allocator.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/*
+ * Obstacles stores the arena's moving circles as a structure of arrays, so the
+ *  collision and movement kernels below can work on 8 (AVX2) or 4 (SSE2) obstacles per instruction.
+ *
+ * The kernels are written on simd::Lanes, so they use the widest instruction set enabled at compile time (see simd.hpp).
+ */
+
+struct Obstacles {
+	typedef std::vector< float, AlignedAllocator< float > > Floats;
+
+	Floats x, y; //center
+	Floats r; //radius
+	Floats dest_x, dest_y; //position being moved toward
+	Floats mv_timer; //time since last movement step
+
+	uint32_t size() const { return uint32_t(x.size()); }
+	glm::vec2 pos(uint32_t i) const { return glm::vec2(x[i], y[i]); }
+	glm::vec2 dest(uint32_t i) const { return glm::vec2(dest_x[i], dest_y[i]); }
+
+	void push_back(glm::vec2 const &pos, float r, glm::vec2 const &dest);
+	void clear();
+
+	//does the circle ('center', 'radius') overlap any of the obstacles listed in ids[0..count)?
+	// (same test as SnakeSim's isCirclesCollide)
+	bool any_collide(uint32_t const *ids, uint32_t count, glm::vec2 const &center, float radius) const;
+
+	//advance every obstacle's movement timer by 'elapsed'.
+	// An obstacle whose timer passes r * rate_mod steps 'step_sq' units toward its destination
+	//  and its index is appended to 'moved'; if its squared distance to the destination is already below 'step_sq'
+	//  it stays put and its index is appended to 'arrived' (in increasing order) so the caller can pick a new destination.
+	void step(float elapsed, float rate_mod, float step_sq, std::vector< uint32_t > *moved, std::vector< uint32_t > *arrived);
+};
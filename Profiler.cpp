@@ -0,0 +1,265 @@
+#include "Profiler.hpp"
+
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+
+Profiler *Profiler::current = nullptr;
+
+char const *Profiler::name(GpuPass pass) {
+	static char const *names[GpuPassCount] = { "upload", "draw", "swap", "screenshot" };
+	return names[pass];
+}
+
+char const *Profiler::name(CpuSection section) {
+	static char const *names[CpuSectionCount] = { "events", "update", "draw", "swap" };
+	return names[section];
+}
+
+Profiler::Profiler(std::string const &csv_filename, uint32_t frames_in_flight) : history(240), slots(frames_in_flight) {
+	assert(frames_in_flight > 0);
+	for (Slot &s : slots) {
+		glGenQueries(GpuPassCount, s.queries);
+	}
+	slot = frames_in_flight - 1; //(so the first begin_frame() uses slot 0)
+
+	if (!csv_filename.empty()) {
+		csv.open(csv_filename.c_str());
+		if (!csv) {
+			throw std::runtime_error("Failed to open profile log '" + csv_filename + "' for writing.");
+		}
+		csv << "frame";
+		for (uint32_t c = 0; c < CpuSectionCount; ++c) csv << ",cpu_" << name(CpuSection(c)) << "_ms";
+		for (uint32_t g = 0; g < GpuPassCount; ++g) csv << ",gpu_" << name(GpuPass(g)) << "_ms";
+		csv << '\n';
+	}
+
+	{ //overlay: flat-colored triangles given in clip coordinates
+		overlay_program = gl_compile_program(
+			//vertex shader:
+			"#version 330\n"
+			"in vec4 Position;\n"
+			"in vec4 Color;\n"
+			"out vec4 color;\n"
+			"void main() {\n"
+			"	gl_Position = Position;\n"
+			"	color = Color;\n"
+			"}\n"
+		,
+			//fragment shader:
+			"#version 330\n"
+			"in vec4 color;\n"
+			"out vec4 fragColor;\n"
+			"void main() {\n"
+			"	fragColor = color;\n"
+			"}\n"
+		);
+		GLuint Position_vec4 = glGetAttribLocation(overlay_program, "Position");
+		GLuint Color_vec4 = glGetAttribLocation(overlay_program, "Color");
+
+		glGenBuffers(1, &overlay_buffer);
+		glGenVertexArrays(1, &overlay_vao);
+		glBindVertexArray(overlay_vao);
+		glBindBuffer(GL_ARRAY_BUFFER, overlay_buffer);
+		glVertexAttribPointer(Position_vec4, 2, GL_FLOAT, GL_FALSE, 4*2 + 4, (GLbyte *)0 + 0);
+		glEnableVertexAttribArray(Position_vec4);
+		glVertexAttribPointer(Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, 4*2 + 4, (GLbyte *)0 + 4*2);
+		glEnableVertexAttribArray(Color_vec4);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+}
+
+Profiler::~Profiler() {
+	collect(true);
+
+	for (Slot &s : slots) {
+		glDeleteQueries(GpuPassCount, s.queries);
+	}
+
+	glDeleteVertexArrays(1, &overlay_vao);
+	overlay_vao = 0;
+	glDeleteBuffers(1, &overlay_buffer);
+	overlay_buffer = 0;
+	glDeleteProgram(overlay_program);
+	overlay_program = 0;
+}
+
+void Profiler::begin_frame() {
+	Slot &s = slots[(slot + 1) % slots.size()];
+	if (s.pending) {
+		//GPU is more than slots.size() frames behind; take what's there without waiting:
+		collect(false);
+		if (s.pending) finish(s, false);
+	}
+	slot = (slot + 1) % slots.size();
+	s.frame = frame++;
+	std::fill(s.used, s.used + GpuPassCount, false);
+	std::fill(s.cpu_ms, s.cpu_ms + CpuSectionCount, 0.0f);
+}
+
+void Profiler::end_frame() {
+	assert(open_pass == -1 && "frame ended with a GPU pass still open");
+	slots[slot].pending = true;
+	collect(false);
+}
+
+void Profiler::begin(GpuPass pass) {
+	Slot &s = slots[slot];
+	if (open_pass != -1 || s.used[pass]) return; //(nested or repeated passes can't be timed; skip them)
+	glBeginQuery(GL_TIME_ELAPSED, s.queries[pass]);
+	open_pass = int32_t(pass);
+	s.used[pass] = true;
+}
+
+void Profiler::end(GpuPass pass) {
+	if (open_pass != int32_t(pass)) return;
+	glEndQuery(GL_TIME_ELAPSED);
+	open_pass = -1;
+}
+
+void Profiler::begin(CpuSection section) {
+	cpu_begin[section] = std::chrono::high_resolution_clock::now();
+}
+
+void Profiler::end(CpuSection section) {
+	auto now = std::chrono::high_resolution_clock::now();
+	slots[slot].cpu_ms[section] += std::chrono::duration< float, std::milli >(now - cpu_begin[section]).count();
+}
+
+void Profiler::collect(bool wait) {
+	//(slot is the newest frame, so slot + 1 is the oldest)
+	for (uint32_t i = 1; i <= slots.size(); ++i) {
+		Slot &s = slots[(slot + i) % slots.size()];
+		if (!s.pending) continue;
+		if (!wait) {
+			bool available = true;
+			for (uint32_t g = 0; g < GpuPassCount && available; ++g) {
+				if (!s.used[g]) continue;
+				GLint ready = GL_FALSE;
+				glGetQueryObjectiv(s.queries[g], GL_QUERY_RESULT_AVAILABLE, &ready);
+				available = (ready == GL_TRUE);
+			}
+			if (!available) break; //(keep frames in order)
+		}
+		finish(s, true);
+	}
+}
+
+void Profiler::finish(Slot &s, bool have_gpu) {
+	Result &r = history[history_next];
+	history_next = (history_next + 1) % history.size();
+	completed += 1;
+
+	r.frame = s.frame;
+	std::copy(s.cpu_ms, s.cpu_ms + CpuSectionCount, r.cpu_ms);
+	for (uint32_t g = 0; g < GpuPassCount; ++g) {
+		r.gpu_ms[g] = -1.0f;
+		if (have_gpu && s.used[g]) {
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v(s.queries[g], GL_QUERY_RESULT, &ns);
+			r.gpu_ms[g] = float(ns) * 1.0e-6f;
+		}
+	}
+	s.pending = false;
+
+	if (csv.is_open()) {
+		csv << r.frame;
+		for (uint32_t c = 0; c < CpuSectionCount; ++c) csv << ',' << r.cpu_ms[c];
+		for (uint32_t g = 0; g < GpuPassCount; ++g) {
+			csv << ',';
+			if (r.gpu_ms[g] >= 0.0f) csv << r.gpu_ms[g];
+		}
+		csv << '\n';
+	}
+}
+
+void Profiler::draw_overlay(glm::uvec2 const &drawable_size) {
+	struct Vertex {
+		Vertex(glm::vec2 const &Position_, glm::u8vec4 const &Color_) : Position(Position_), Color(Color_) { }
+		glm::vec2 Position;
+		glm::u8vec4 Color;
+	};
+	static_assert(sizeof(Vertex) == 4*2 + 4, "Profiler overlay Vertex should be packed");
+
+	const glm::u8vec4 cpu_colors[CpuSectionCount] = {
+		glm::u8vec4(0x40, 0x80, 0xff, 0xff), glm::u8vec4(0x40, 0xd0, 0x40, 0xff), glm::u8vec4(0xff, 0xa0, 0x20, 0xff), glm::u8vec4(0xa0, 0xa0, 0xa0, 0xff)
+	};
+	const glm::u8vec4 gpu_colors[GpuPassCount] = {
+		glm::u8vec4(0x20, 0xe0, 0xe0, 0xff), glm::u8vec4(0xff, 0x60, 0x20, 0xff), glm::u8vec4(0xa0, 0xa0, 0xa0, 0xff), glm::u8vec4(0xe0, 0x40, 0xe0, 0xff)
+	};
+
+	//layout in pixels: one 2px column per frame; each strip is 'strip_ms' tall at 'px_per_ms':
+	const float column = 2.0f;
+	const float strip_ms = 1000.0f / 30.0f;
+	const float px_per_ms = 2.0f;
+	const float strip = strip_ms * px_per_ms;
+	const float margin = 8.0f;
+
+	std::vector< Vertex > vertices;
+	glm::vec2 px_to_clip = 2.0f / glm::vec2(drawable_size);
+	auto rect = [&](glm::vec2 min, glm::vec2 max, glm::u8vec4 const &color) {
+		min = min * px_to_clip - 1.0f;
+		max = max * px_to_clip - 1.0f;
+		vertices.emplace_back(glm::vec2(min.x, min.y), color);
+		vertices.emplace_back(glm::vec2(max.x, min.y), color);
+		vertices.emplace_back(glm::vec2(max.x, max.y), color);
+		vertices.emplace_back(glm::vec2(min.x, min.y), color);
+		vertices.emplace_back(glm::vec2(max.x, max.y), color);
+		vertices.emplace_back(glm::vec2(min.x, max.y), color);
+	};
+
+	uint32_t count = uint32_t(std::min< uint64_t >(completed, history.size()));
+	float width = column * history.size();
+	glm::vec2 gpu_base = glm::vec2(margin, margin);
+	glm::vec2 cpu_base = glm::vec2(margin, margin + strip + margin);
+
+	//backgrounds + 1/60s lines:
+	rect(gpu_base, gpu_base + glm::vec2(width, strip), glm::u8vec4(0x00, 0x00, 0x00, 0xa0));
+	rect(cpu_base, cpu_base + glm::vec2(width, strip), glm::u8vec4(0x00, 0x00, 0x00, 0xa0));
+
+	for (uint32_t i = 0; i < count; ++i) {
+		//oldest on the left:
+		Result const &r = history[(history_next + history.size() - count + i) % history.size()];
+		float x = (history.size() - count + i) * column;
+
+		float y = 0.0f;
+		for (uint32_t c = 0; c < CpuSectionCount; ++c) {
+			float h = std::min(r.cpu_ms[c] * px_per_ms, strip - y);
+			rect(cpu_base + glm::vec2(x, y), cpu_base + glm::vec2(x + column, y + h), cpu_colors[c]);
+			y += h;
+		}
+		y = 0.0f;
+		for (uint32_t g = 0; g < GpuPassCount; ++g) {
+			if (r.gpu_ms[g] < 0.0f) continue;
+			float h = std::min(r.gpu_ms[g] * px_per_ms, strip - y);
+			rect(gpu_base + glm::vec2(x, y), gpu_base + glm::vec2(x + column, y + h), gpu_colors[g]);
+			y += h;
+		}
+	}
+
+	float line = 1000.0f / 60.0f * px_per_ms;
+	rect(gpu_base + glm::vec2(0.0f, line), gpu_base + glm::vec2(width, line + 1.0f), glm::u8vec4(0xff, 0xff, 0xff, 0x80));
+	rect(cpu_base + glm::vec2(0.0f, line), cpu_base + glm::vec2(width, line + 1.0f), glm::u8vec4(0xff, 0xff, 0xff, 0x80));
+
+	glBindBuffer(GL_ARRAY_BUFFER, overlay_buffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertices[0]), vertices.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST);
+
+	glUseProgram(overlay_program);
+	glBindVertexArray(overlay_vao);
+	glDrawArrays(GL_TRIANGLES, 0, GLsizei(vertices.size()));
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	GL_ERRORS(); //PARANOIA: print errors just in case we did something wrong.
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+ * Profiler times each frame's CPU sections (with std::chrono) and GPU passes (with GL_TIME_ELAPSED queries),
+ *  so a slow frame can be pinned on the CPU or the GPU.
+ *
+ * GPU results arrive a few frames late; queries live in a ring of 'frames_in_flight' slots and are
+ *  only read once available, so profiling never stalls the pipeline. (If the GPU falls more than
+ *  frames_in_flight frames behind, the oldest frame's GPU timings are dropped.)
+ *
+ * Completed frames are kept in 'history' (drawn by draw_overlay) and, optionally, appended to a CSV log.
+ *
+ * Code being profiled uses Profiler::current (nullptr when profiling is off), usually via Scope:
+ *   { Profiler::Scope scope(Profiler::DrawPass); ...GL calls... }
+ */
+
+struct Profiler {
+	//GPU passes (GL_TIME_ELAPSED queries can't nest, so at most one pass may be open at a time):
+	enum GpuPass : uint32_t {
+		UploadPass, //streaming per-frame data to buffers
+		DrawPass, //the current Mode's draw calls
+		SwapPass, //SDL_GL_SwapWindow
+		ScreenshotPass, //reading back the frame for a screenshot
+		GpuPassCount
+	};
+	//CPU sections (may repeat within a frame; times add up):
+	enum CpuSection : uint32_t {
+		EventsSection, //handle_event
+		UpdateSection, //update
+		DrawSection, //draw
+		SwapSection, //SDL_GL_SwapWindow
+		CpuSectionCount
+	};
+	static char const *name(GpuPass pass);
+	static char const *name(CpuSection section);
+
+	//'csv_filename' (if not empty) gets a line per frame; NOTE: throws if it can't be opened.
+	Profiler(std::string const &csv_filename = "", uint32_t frames_in_flight = 4);
+	~Profiler(); //waits for outstanding GPU results (so the CSV is complete); needs the GL context
+	Profiler(Profiler const &) = delete;
+	Profiler &operator=(Profiler const &) = delete;
+
+	//bracket each frame:
+	void begin_frame();
+	void end_frame();
+
+	void begin(GpuPass pass);
+	void end(GpuPass pass);
+	void begin(CpuSection section);
+	void end(CpuSection section);
+
+	//times a pass or section for as long as it is in scope (does nothing if Profiler::current is null):
+	struct Scope {
+		Scope(GpuPass pass_) : gpu(true), index(pass_) { if (current) current->begin(pass_); }
+		Scope(CpuSection section_) : gpu(false), index(section_) { if (current) current->begin(section_); }
+		~Scope() {
+			if (!current) return;
+			if (gpu) current->end(GpuPass(index));
+			else current->end(CpuSection(index));
+		}
+		bool gpu;
+		uint32_t index;
+	};
+
+	//draw a graph of recent frame times (top: CPU, bottom: GPU; the line marks 1/60s) in the lower left corner:
+	void draw_overlay(glm::uvec2 const &drawable_size);
+
+	struct Result {
+		uint64_t frame = 0;
+		float cpu_ms[CpuSectionCount];
+		float gpu_ms[GpuPassCount]; //negative => pass didn't run (or its result was dropped)
+	};
+	std::vector< Result > history; //ring of the most recent completed frames
+	uint32_t history_next = 0; //where the next result goes
+	uint64_t completed = 0; //frames completed so far
+	//the most recently completed frame (only valid once completed > 0):
+	Result const &latest() const { return history[(history_next + uint32_t(history.size()) - 1) % history.size()]; }
+
+	//the profiler that Scope (and any other instrumentation) reports to:
+	static Profiler *current;
+
+private:
+	struct Slot {
+		uint64_t frame = 0;
+		bool pending = false; //waiting on query results
+		GLuint queries[GpuPassCount];
+		bool used[GpuPassCount];
+		float cpu_ms[CpuSectionCount];
+	};
+	std::vector< Slot > slots;
+	uint32_t slot = 0; //slot for the frame in progress
+	uint64_t frame = 0;
+	int32_t open_pass = -1; //pass with an active query, if any
+	std::chrono::high_resolution_clock::time_point cpu_begin[CpuSectionCount];
+
+	//read (or, if 'wait', wait for) results of pending slots, oldest first:
+	void collect(bool wait);
+	void finish(Slot &s, bool have_gpu);
+
+	std::ofstream csv;
+
+	//overlay drawing:
+	GLuint overlay_program = 0;
+	GLuint overlay_buffer = 0;
+	GLuint overlay_vao = 0;
+};
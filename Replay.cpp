@@ -0,0 +1,138 @@
+#include "Replay.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <cassert>
+
+namespace {
+	const char Magic[4] = {'b','s','r','p'};
+	const uint32_t Version = 1;
+
+	template< typename T >
+	void put(std::vector< uint8_t > *ops, T const &val) {
+		size_t at = ops->size();
+		ops->resize(at + sizeof(T));
+		std::memcpy(ops->data() + at, &val, sizeof(T));
+	}
+	template< typename T >
+	T get(std::vector< uint8_t > const &ops, size_t *at) {
+		if (*at + sizeof(T) > ops.size()) {
+			throw std::runtime_error("Replay is truncated.");
+		}
+		T val;
+		std::memcpy(&val, ops.data() + *at, sizeof(T));
+		*at += sizeof(T);
+		return val;
+	}
+}
+
+void Replay::steer(glm::vec2 const &dir) {
+	//SnakeSim::steer ignores directions with a zero component, so they needn't be stored:
+	if (dir.x == 0.0f || dir.y == 0.0f) return;
+
+	if (last_steer != size_t(-1)) {
+		//still before the next update, so the new direction replaces the old one:
+		ops.resize(last_steer);
+	}
+	last_steer = ops.size();
+	ops.emplace_back(SteerOp);
+	put(&ops, dir.x);
+	put(&ops, dir.y);
+	last_updates = -1;
+}
+
+void Replay::mouth(bool open) {
+	if (mouth_open == int8_t(open)) return;
+	mouth_open = int8_t(open);
+	ops.emplace_back(open ? MouthOpenOp : MouthClosedOp);
+	last_steer = -1; //(later steers are recorded after this op, not folded into an earlier one)
+	last_updates = -1;
+}
+
+void Replay::update(float elapsed) {
+	if (last_updates != size_t(-1)) {
+		float run_elapsed;
+		std::memcpy(&run_elapsed, ops.data() + last_updates + 1, sizeof(float));
+		uint32_t count;
+		std::memcpy(&count, ops.data() + last_updates + 1 + sizeof(float), sizeof(uint32_t));
+		if (std::memcmp(&run_elapsed, &elapsed, sizeof(float)) == 0 && count < uint32_t(-1)) {
+			count += 1;
+			std::memcpy(ops.data() + last_updates + 1 + sizeof(float), &count, sizeof(uint32_t));
+			return;
+		}
+	}
+	last_updates = ops.size();
+	ops.emplace_back(UpdatesOp);
+	put(&ops, elapsed);
+	put(&ops, uint32_t(1));
+	last_steer = -1;
+}
+
+uint64_t Replay::play(SnakeSim *sim) const {
+	assert(sim);
+	uint64_t updates = 0;
+	size_t at = 0;
+	while (at < ops.size()) {
+		uint8_t op = ops[at++];
+		if (op == SteerOp) {
+			float x = get< float >(ops, &at);
+			float y = get< float >(ops, &at);
+			sim->steer(glm::vec2(x, y));
+		} else if (op == MouthOpenOp) {
+			sim->snake_mouth_open = true;
+		} else if (op == MouthClosedOp) {
+			sim->snake_mouth_open = false;
+		} else if (op == UpdatesOp) {
+			float elapsed = get< float >(ops, &at);
+			uint32_t count = get< uint32_t >(ops, &at);
+			for (uint32_t i = 0; i < count; ++i) {
+				sim->update(elapsed);
+			}
+			updates += count;
+		} else {
+			throw std::runtime_error("Replay has unknown op '" + std::to_string(int(op)) + "'.");
+		}
+	}
+	return updates;
+}
+
+void Replay::save(std::string const &filename) const {
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open replay file '" + filename + "' for writing.");
+	}
+	uint32_t size = uint32_t(ops.size());
+	file.write(Magic, sizeof(Magic));
+	file.write(reinterpret_cast< char const * >(&Version), sizeof(Version));
+	file.write(reinterpret_cast< char const * >(&seed), sizeof(seed));
+	file.write(reinterpret_cast< char const * >(&size), sizeof(size));
+	file.write(reinterpret_cast< char const * >(ops.data()), ops.size());
+	if (!file) {
+		throw std::runtime_error("Failed to write replay to '" + filename + "'.");
+	}
+}
+
+Replay Replay::load(std::string const &filename) {
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open replay file '" + filename + "'.");
+	}
+	char magic[4];
+	uint32_t version = 0;
+	uint32_t size = 0;
+	Replay ret;
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast< char * >(&version), sizeof(version));
+	file.read(reinterpret_cast< char * >(&ret.seed), sizeof(ret.seed));
+	file.read(reinterpret_cast< char * >(&size), sizeof(size));
+	if (!file || std::memcmp(magic, Magic, sizeof(Magic)) != 0 || version != Version) {
+		throw std::runtime_error("File '" + filename + "' is not a (version " + std::to_string(Version) + ") replay.");
+	}
+	ret.ops.resize(size);
+	file.read(reinterpret_cast< char * >(ret.ops.data()), size);
+	if (!file) {
+		throw std::runtime_error("Failed to read replay from '" + filename + "'.");
+	}
+	return ret;
+}
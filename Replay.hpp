@@ -0,0 +1,55 @@
+#pragma once
+
+#include "SnakeSim.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+ * Replay records one game as its seed plus the stream of inputs and updates SnakeSim saw,
+ *  so the game can be played back exactly (and without a window, as fast as the CPU allows).
+ *
+ * Inputs are timestamped by their place in the stream: each one applies before the updates
+ *  that follow it. Runs of same-length updates are stored as a single count, so a
+ *  fixed-tick game costs a few bytes per input, no matter how long it runs.
+ */
+
+struct Replay {
+	Replay() = default;
+	explicit Replay(uint32_t seed_) : seed(seed_) { }
+
+	//----- recording -----
+	//call these alongside the matching SnakeSim calls, in the same order:
+	void steer(glm::vec2 const &dir); //sim.steer(dir)
+	void mouth(bool open); //sim.snake_mouth_open = open
+	void update(float elapsed); //sim.update(elapsed)
+
+	//----- playback -----
+	//feed the recorded inputs to 'sim' (which should be a fresh SnakeSim(seed)).
+	// returns the number of updates run:
+	uint64_t play(SnakeSim *sim) const;
+
+	//NOTE: load and save throw on error
+	void save(std::string const &filename) const;
+	static Replay load(std::string const &filename);
+
+	uint32_t seed = 0;
+
+	//encoded stream: one tag byte per op, then its (native-endian) payload:
+	enum Op : uint8_t {
+		SteerOp = 's', //float x, float y
+		MouthOpenOp = 'o',
+		MouthClosedOp = 'c',
+		UpdatesOp = 'u', //float elapsed, uint32_t count
+	};
+	std::vector< uint8_t > ops;
+
+private:
+	//offsets of the ops that later calls can fold into (or -1 if there isn't one):
+	size_t last_steer = -1;
+	size_t last_updates = -1;
+	int8_t mouth_open = -1; //last recorded mouth state (-1 => none yet)
+};
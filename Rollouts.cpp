@@ -0,0 +1,65 @@
+#include "Rollouts.hpp"
+
+#include "Trace.hpp"
+
+RolloutResult run_rollout(uint32_t seed, uint32_t max_steps, float tick, RolloutPolicy const &policy) {
+	TRACE_ZONE("rollout");
+	SnakeSim sim(seed);
+
+	RolloutResult result;
+	result.seed = seed;
+	TRACE_DETAIL_SCOPE(); //(per-update zones only with --trace-detail)
+	while (result.steps < max_steps && !sim.over) {
+		policy(sim);
+		sim.update(tick);
+		result.steps += 1;
+	}
+
+	if (sim.over) {
+		result.outcome = (sim.escaped() ? RolloutResult::Escaped : RolloutResult::Crashed);
+	} else {
+		result.outcome = RolloutResult::OutOfSteps;
+	}
+	result.time = float(sim.time);
+	result.foods_eaten = sim.foods_eaten;
+	result.snake_r = sim.snake_r;
+	return result;
+}
+
+namespace {
+	struct Job {
+		uint32_t first_seed;
+		uint32_t max_steps;
+		float tick;
+		RolloutPolicy const *policy;
+		std::vector< RolloutResult > *results;
+	};
+
+	//play games [begin,end) of 'job', splitting off halves for other workers to steal:
+	void play(ThreadPool &pool, Job const &job, uint32_t begin, uint32_t end) {
+		while (end - begin > 1) {
+			uint32_t mid = begin + (end - begin) / 2;
+			pool.submit([&pool, &job, mid, end](){ play(pool, job, mid, end); });
+			end = mid;
+		}
+		(*job.results)[begin] = run_rollout(job.first_seed + begin, job.max_steps, job.tick, *job.policy);
+	}
+}
+
+std::vector< RolloutResult > run_rollouts(ThreadPool &pool, uint32_t first_seed, uint32_t count, uint32_t max_steps, float tick, RolloutPolicy const &policy) {
+	std::vector< RolloutResult > results(count);
+	if (count == 0) return results;
+
+	Job job;
+	job.first_seed = first_seed;
+	job.max_steps = max_steps;
+	job.tick = tick;
+	job.policy = &policy;
+	job.results = &results;
+
+	//(job lives on this stack frame, which outlasts every task because of the wait below)
+	pool.submit([&pool, &job, count](){ play(pool, job, 0, count); });
+	pool.wait();
+
+	return results;
+}
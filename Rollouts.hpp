@@ -0,0 +1,37 @@
+#pragma once
+
+#include "SnakeSim.hpp"
+#include "ThreadPool.hpp"
+
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+/*
+ * Rollouts play many headless games in parallel on a ThreadPool (e.g., to evaluate a bot).
+ */
+
+struct RolloutResult {
+	enum Outcome : uint8_t {
+		Escaped, //left through the exit
+		Crashed, //hit a wall, an obstacle, or its own tail
+		OutOfSteps, //still going when the step budget ran out
+	};
+	uint32_t seed = 0;
+	Outcome outcome = OutOfSteps;
+	uint32_t steps = 0;
+	float time = 0.0f; //game time played (seconds)
+	uint32_t foods_eaten = 0;
+	float snake_r = 0.0f; //final radius
+};
+
+//called before every step of a game to set the snake's input (via sim.steer / sim.snake_mouth_open).
+// NOTE: called from several threads at once.
+typedef std::function< void(SnakeSim &sim) > RolloutPolicy;
+
+//play one game per seed in [first_seed, first_seed + count), each for at most 'max_steps' updates of 'tick' seconds.
+// results are in seed order:
+std::vector< RolloutResult > run_rollouts(ThreadPool &pool, uint32_t first_seed, uint32_t count, uint32_t max_steps, float tick, RolloutPolicy const &policy);
+
+//play one game (what run_rollouts does for each seed):
+RolloutResult run_rollout(uint32_t seed, uint32_t max_steps, float tick, RolloutPolicy const &policy);
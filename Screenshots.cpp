@@ -0,0 +1,130 @@
+#include "Screenshots.hpp"
+
+#include "gl_errors.hpp"
+#include "load_save_png.hpp"
+
+#include <cstring>
+#include <iostream>
+
+Screenshots::Screenshots(uint32_t max_queued_) : max_queued(max_queued_) {
+	saver = std::thread(&Screenshots::save_jobs, this);
+}
+
+Screenshots::~Screenshots() {
+	//finish every readback (waiting on the GPU and, if the queue is full, on the saver thread):
+	while (!readbacks.empty()) {
+		Readback &readback = readbacks.front();
+		glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(-1));
+		{
+			std::unique_lock< std::mutex > lock(jobs_mutex);
+			jobs_cv.wait(lock, [this](){ return jobs.size() < max_queued; });
+		}
+		queue(readback);
+		readbacks.pop_front();
+	}
+
+	{
+		std::unique_lock< std::mutex > lock(jobs_mutex);
+		quit = true;
+	}
+	jobs_cv.notify_all();
+	saver.join();
+
+	if (!free_buffers.empty()) {
+		glDeleteBuffers(GLsizei(free_buffers.size()), free_buffers.data());
+		free_buffers.clear();
+	}
+	GL_ERRORS();
+}
+
+void Screenshots::request(std::string const &filename, glm::uvec2 const &size, GLenum read_buffer) {
+	Readback readback;
+	readback.filename = filename;
+	readback.size = size;
+	if (!free_buffers.empty()) {
+		readback.buffer = free_buffers.back();
+		free_buffers.pop_back();
+	} else {
+		glGenBuffers(1, &readback.buffer);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	glBufferData(GL_PIXEL_PACK_BUFFER, size.x * size.y * sizeof(glm::u8vec4), nullptr, GL_STREAM_READ);
+	glReadBuffer(read_buffer);
+	//with a pack buffer bound, the last argument is an offset into it and this returns right away:
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid *)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	readbacks.emplace_back(readback);
+	GL_ERRORS();
+}
+
+void Screenshots::poll() {
+	while (!readbacks.empty()) {
+		Readback &readback = readbacks.front();
+		GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status == GL_TIMEOUT_EXPIRED) break; //(later ones can't be done either)
+		{
+			std::unique_lock< std::mutex > lock(jobs_mutex);
+			if (jobs.size() >= max_queued) break; //saver thread is behind; try again next frame
+		}
+		queue(readback);
+		readbacks.pop_front();
+	}
+}
+
+void Screenshots::queue(Readback &readback) {
+	Job job;
+	job.filename = readback.filename;
+	job.size = readback.size;
+	job.data.resize(readback.size.x * readback.size.y);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	size_t bytes = job.data.size() * sizeof(glm::u8vec4);
+	void const *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+	if (pixels) {
+		std::memcpy(job.data.data(), pixels, bytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	} else {
+		std::cerr << "WARNING: failed to map screenshot buffer; '" << job.filename << "' not saved." << std::endl;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	glDeleteSync(readback.fence);
+	readback.fence = 0;
+	free_buffers.emplace_back(readback.buffer);
+	readback.buffer = 0;
+	GL_ERRORS();
+
+	if (!pixels) return;
+	{
+		std::unique_lock< std::mutex > lock(jobs_mutex);
+		jobs.emplace_back(std::move(job));
+	}
+	jobs_cv.notify_all();
+}
+
+void Screenshots::save_jobs() {
+	while (true) {
+		Job job;
+		{
+			std::unique_lock< std::mutex > lock(jobs_mutex);
+			jobs_cv.wait(lock, [this](){ return quit || !jobs.empty(); });
+			if (jobs.empty()) return; //(quit, and nothing left to save)
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		jobs_cv.notify_all(); //(there's room in the queue now)
+
+		//the framebuffer's alpha isn't meaningful, so make the image opaque:
+		for (auto &px : job.data) {
+			px.a = 0xff;
+		}
+		try {
+			save_png(job.filename, job.size, job.data.data(), LowerLeftOrigin);
+		} catch (std::exception const &e) {
+			std::cerr << "WARNING: failed to save screenshot '" << job.filename << "': " << e.what() << std::endl;
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Screenshots saves the framebuffer to PNG files without stalling the frame:
+ *  request() starts an asynchronous glReadPixels into a pixel buffer object and fences it;
+ *  poll() (once per frame) copies finished readbacks out and hands them to a saver thread,
+ *  which fixes up alpha and runs save_png.
+ *
+ * At most 'max_queued' screenshots wait for the saver thread; past that, finished readbacks stay
+ *  in their pixel buffers until there is room (poll() never blocks).
+ *
+ * Create and destroy with the GL context current; the destructor waits for every requested
+ *  screenshot to be written.
+ */
+
+struct Screenshots {
+	Screenshots(uint32_t max_queued = 4);
+	~Screenshots();
+	Screenshots(Screenshots const &) = delete;
+	Screenshots &operator=(Screenshots const &) = delete;
+
+	//start reading back the lower-left 'size' pixels of 'read_buffer' of the bound read framebuffer (e.g., GL_FRONT of the window);
+	// they will be saved to 'filename' by a later poll() + the saver thread:
+	void request(std::string const &filename, glm::uvec2 const &size, GLenum read_buffer);
+
+	//hand any readbacks the GPU has finished to the saver thread (call once per frame):
+	void poll();
+
+	//----- main thread -----
+	struct Readback {
+		std::string filename;
+		glm::uvec2 size = glm::uvec2(0);
+		GLuint buffer = 0; //GL_PIXEL_PACK_BUFFER
+		GLsync fence = 0;
+	};
+	std::deque< Readback > readbacks; //oldest first
+	std::vector< GLuint > free_buffers; //pixel buffers from finished readbacks, for reuse
+
+	//hand 'readback' (which must be finished) to the saver thread:
+	void queue(Readback &readback);
+
+	//----- shared with saver thread -----
+	struct Job {
+		std::string filename;
+		glm::uvec2 size;
+		std::vector< glm::u8vec4 > data;
+	};
+	uint32_t max_queued;
+	std::deque< Job > jobs;
+	bool quit = false;
+	std::mutex jobs_mutex;
+	std::condition_variable jobs_cv;
+
+	//----- saver thread -----
+	std::thread saver;
+	void save_jobs();
+};
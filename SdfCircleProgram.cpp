@@ -0,0 +1,56 @@
+#include "SdfCircleProgram.hpp"
+
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+
+SdfCircleProgram::SdfCircleProgram() {
+	program = gl_compile_program(
+		//vertex shader:
+		"#version 330\n"
+		"uniform mat4 OBJECT_TO_CLIP;\n"
+		"uniform float PIXEL_SIZE;\n"
+		"in vec2 Corner;\n"
+		"in vec2 Center;\n"
+		"in float Radius;\n"
+		"in vec4 Color;\n"
+		"out vec2 offset;\n" //position relative to the center
+		"flat out float radius;\n"
+		"flat out vec4 color;\n"
+		"void main() {\n"
+		"	offset = Corner * (Radius + PIXEL_SIZE);\n"
+		"	gl_Position = OBJECT_TO_CLIP * vec4(Center + offset, 0.0, 1.0);\n"
+		"	radius = Radius;\n"
+		"	color = Color;\n"
+		"}\n"
+	,
+		//fragment shader:
+		"#version 330\n"
+		"in vec2 offset;\n"
+		"flat in float radius;\n"
+		"flat in vec4 color;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	float dist = length(offset) - radius;\n" //signed distance to the edge (negative inside)
+		"	float coverage = clamp(0.5 - dist / fwidth(dist), 0.0, 1.0);\n" //fade over one pixel
+		"	if (coverage == 0.0) discard;\n"
+		"	fragColor = vec4(color.rgb, color.a * coverage);\n"
+		"}\n"
+	);
+
+	//look up the locations of vertex attributes:
+	Corner_vec2 = glGetAttribLocation(program, "Corner");
+	Center_vec2 = glGetAttribLocation(program, "Center");
+	Radius_float = glGetAttribLocation(program, "Radius");
+	Color_vec4 = glGetAttribLocation(program, "Color");
+
+	//look up the locations of uniforms:
+	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
+	PIXEL_SIZE_float = glGetUniformLocation(program, "PIXEL_SIZE");
+
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+}
+
+SdfCircleProgram::~SdfCircleProgram() {
+	glDeleteProgram(program);
+	program = 0;
+}
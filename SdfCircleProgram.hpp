@@ -0,0 +1,23 @@
+#pragma once
+
+#include "GL.hpp"
+
+//Shader program that draws instanced antialiased circles, one quad each:
+// a unit quad (Corner in [-1,1]^2) is scaled to cover each instance's circle, and the fragment
+// shader fades alpha across the circle's edge using the distance from the Center.
+//Takes the same per-instance attributes as CircleProgram.
+struct SdfCircleProgram {
+	SdfCircleProgram();
+	~SdfCircleProgram();
+
+	GLuint program = 0;
+	//Attribute (per-vertex variable) locations:
+	GLuint Corner_vec2 = -1U;
+	//Attribute (per-instance variable) locations:
+	GLuint Center_vec2 = -1U;
+	GLuint Radius_float = -1U;
+	GLuint Color_vec4 = -1U;
+	//Uniform (per-invocation variable) locations:
+	GLuint OBJECT_TO_CLIP_mat4 = -1U;
+	GLuint PIXEL_SIZE_float = -1U; //size of a pixel in object units (quads are grown by this much so edges aren't clipped)
+};
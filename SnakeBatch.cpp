@@ -0,0 +1,241 @@
+#include "SnakeBatch.hpp"
+
+#include "simd.hpp"
+
+#include <cassert>
+#include <utility>
+
+SnakeBatch::SnakeBatch(uint32_t count_, uint32_t first_seed, SnakeState const &settings) : rules(settings), count(count_), next_seed(first_seed) {
+	uint32_t padded = (count + simd::Lanes::Width - 1) / simd::Lanes::Width * simd::Lanes::Width;
+	for (Floats *lane : { &pos_x, &pos_y, &prev_x, &prev_y, &vel_x, &vel_y, &r, &r_actual,
+		&r_lag_counter, &decay_counter, &food_counter, &body_interval, &exit_x, &exit_y }) {
+		lane->assign(padded, 0.0f);
+	}
+	time.assign(count, 0.0);
+	len.assign(count, 0);
+	mouth_open.assign(count, 0);
+	over.assign(count, 0);
+	ended.assign(count, 0);
+	escaped.assign(count, 0);
+	seeds.assign(count, 0);
+	arenas.resize(count);
+
+	for (uint32_t i = 0; i < count; ++i) {
+		reset(i, next_seed++);
+	}
+}
+
+void SnakeBatch::reset(uint32_t i, uint32_t seed) {
+	//level generation is SnakeSim's; take the result apart into lanes + arena:
+	SnakeSim sim(seed, rules);
+
+	seeds[i] = seed;
+	pos_x[i] = sim.snake_pos.x;
+	pos_y[i] = sim.snake_pos.y;
+	prev_x[i] = sim.snake_pos_prev.x;
+	prev_y[i] = sim.snake_pos_prev.y;
+	vel_x[i] = sim.snake_vel.x;
+	vel_y[i] = sim.snake_vel.y;
+	r[i] = sim.snake_r;
+	r_actual[i] = sim.snake_r_actual;
+	r_lag_counter[i] = sim.snake_r_lag_counter;
+	decay_counter[i] = sim.snake_decay_counter;
+	food_counter[i] = sim.food_counter;
+	body_interval[i] = sim.snake_body_interval;
+	exit_x[i] = sim.exit_pos.x;
+	exit_y[i] = sim.exit_pos.y;
+	time[i] = sim.time;
+	len[i] = sim.snake_len;
+	mouth_open[i] = sim.snake_mouth_open;
+	over[i] = sim.over;
+
+	Arena &arena = arenas[i];
+	arena.body = std::move(sim.snake_body);
+	arena.obstacles = std::move(sim.obstacles);
+	arena.obstacle_grid = std::move(sim.obstacle_grid);
+	arena.foods = std::move(sim.foods);
+	arena.rng = sim.rng;
+	arena.arena_x_dist = sim.arena_x_dist;
+	arena.arena_y_dist = sim.arena_y_dist;
+}
+
+void SnakeBatch::steer(uint32_t i, glm::vec2 const &dir) {
+	assert(i < count);
+	if (dir.x != 0.0f && dir.y != 0.0f) {
+		float scaling = rules.snake_speed / std::sqrt(dir.y * dir.y + dir.x * dir.x);
+		vel_x[i] = dir.x * scaling;
+		vel_y[i] = dir.y * scaling;
+	}
+}
+
+void SnakeBatch::step(float elapsed) {
+	using namespace simd;
+	uint32_t padded = uint32_t(pos_x.size());
+
+	//NOTE: lanes use the same float operations, in the same order, as SnakeSim::update.
+
+	// ---- snake movement + snake v wall collision (all games) ----
+	{
+		Lanes e = elapsed;
+		Lanes ax = rules.arena_pos.x, ay = rules.arena_pos.y;
+		Lanes arx = rules.arena_radius.x, ary = rules.arena_radius.y;
+		Lanes wall = rules.wall_radius;
+		Lanes exit_r = rules.exit_r;
+		Lanes scale = 0.9f;
+		for (uint32_t i = 0; i < padded; i += Lanes::Width) {
+			Lanes px = load(&pos_x[i]), py = load(&pos_y[i]);
+			store(&prev_x[i], px);
+			store(&prev_y[i], py);
+			px = px + load(&vel_x[i]) * e;
+			py = py + load(&vel_y[i]) * e;
+			store(&pos_x[i], px);
+			store(&pos_y[i], py);
+
+			Lanes sr = load(&r[i]);
+			Lanes dx = px - load(&exit_x[i]);
+			Lanes dy = py - load(&exit_y[i]);
+			Lanes rs = sr + exit_r;
+			Mask in_exit = (dx * dx + dy * dy) < (scale * rs) * rs;
+			Mask out = (abs(ax - px) > (arx - sr) - wall) | (abs(ay - py) > (ary - sr) - wall);
+			uint32_t hits = bits(and_not(out, in_exit));
+			for (uint32_t b = 0; b < Lanes::Width && i + b < count; ++b) {
+				if ((hits >> b) & 1) over[i + b] = 1;
+			}
+		}
+		for (uint32_t i = 0; i < count; ++i) {
+			time[i] += elapsed;
+		}
+	}
+
+	// ---- body, tail / obstacle collision, food, obstacle movement (game by game) ----
+	for (uint32_t i = 0; i < count; ++i) {
+		step_arena(i, elapsed);
+	}
+
+	// ---- snake growth/decay (all games) ----
+	{
+		Lanes e = elapsed;
+		Lanes lag_threshold = 0.5f * rules.snake_r_lag_step;
+		Lanes lag_rate = rules.snake_r_lag_rate;
+		Lanes lag_step = rules.snake_r_lag_step;
+		Lanes r_min = rules.snake_r_min;
+		Lanes decay_rate = rules.snake_decay_rate;
+		Lanes decay_step = rules.snake_decay_step;
+		for (uint32_t i = 0; i < padded; i += Lanes::Width) {
+			Lanes ra = load(&r_actual[i]);
+			Lanes sr = load(&r[i]);
+
+			Mask lagging = abs(ra - sr) > lag_threshold;
+			Lanes lag = select(lagging, load(&r_lag_counter[i]) + e, load(&r_lag_counter[i]));
+			Mask change = lagging & (lag > lag_rate);
+			lag = select(change, lag - lag_rate, lag);
+			sr = select(change, select(ra > sr, sr + lag_step, sr - lag_step), sr);
+			store(&r_lag_counter[i], lag);
+			store(&r[i], sr);
+			store(&body_interval[i], select(change, sr, load(&body_interval[i])));
+
+			Mask thick = ra > r_min;
+			Lanes decay = select(thick, load(&decay_counter[i]) + e, load(&decay_counter[i]));
+			Mask burn = thick & (decay > decay_rate);
+			store(&decay_counter[i], select(burn, decay - decay_rate, decay));
+			store(&r_actual[i], select(burn, ra - decay_step, ra));
+		}
+	}
+
+	// ---- auto-reset finished games ----
+	for (uint32_t i = 0; i < count; ++i) {
+		ended[i] = over[i];
+		escaped[i] = 0;
+		if (over[i]) {
+			escaped[i] = std::abs(rules.arena_pos.x - pos_x[i]) > rules.arena_radius.x
+			          || std::abs(rules.arena_pos.y - pos_y[i]) > rules.arena_radius.y;
+			reset(i, next_seed++);
+		}
+	}
+}
+
+void SnakeBatch::step_arena(uint32_t i, float elapsed) {
+	Arena &arena = arenas[i];
+	glm::vec2 pos = glm::vec2(pos_x[i], pos_y[i]);
+	glm::vec2 prev = glm::vec2(prev_x[i], prev_y[i]);
+	float sr = r[i];
+
+	// ---- body ----
+	if (!arena.body.empty() && float(time[i] - arena.body.back().born) > body_interval[i]) {
+		float dt = float(time[i] - arena.body.back().born) - body_interval[i];
+		float scale_front = dt / elapsed;
+		float scale_back = 1.0f - scale_front;
+		arena.body.push_back(pos * scale_back + prev * scale_front, time[i] - dt);
+	}
+	arena.body.trim(len[i]);
+
+	// ---- snake v snake tail collision ----
+	for (uint32_t s = 0; s + rules.snake_body_solid_index < arena.body.size(); s++) {
+		if (SnakeSim::isCirclesCollide(pos, sr, arena.body[s].pos, sr)) {
+			over[i] = 1;
+		}
+	}
+
+	auto obstacles_collide = [&](glm::vec2 const &center, float cr) {
+		glm::vec2 reach = glm::vec2(cr + rules.obs_r_max);
+		nearby.clear();
+		arena.obstacle_grid.for_each(center - reach, center + reach, [this](uint32_t o) {
+			nearby.emplace_back(o);
+		});
+		return arena.obstacles.any_collide(nearby.data(), uint32_t(nearby.size()), center, cr);
+	};
+
+	// ---- snake v obstacle collision ----
+	if (obstacles_collide(pos, sr)) {
+		over[i] = 1;
+	}
+
+	// ---- snake v food collision ----
+	if (mouth_open[i]) {
+		glm::vec2 reach = glm::vec2(sr + rules.food_r);
+		uint32_t eaten = SpatialGrid::None;
+		arena.foods.grid.any(pos - reach, pos + reach, [&](uint32_t f) {
+			glm::vec3 const &food = arena.foods[f];
+			if (SnakeSim::isCirclesCollide(pos, sr, glm::vec2(food.x, food.y), food.z)) {
+				eaten = f;
+				return true;
+			}
+			return false;
+		});
+		if (eaten != SpatialGrid::None) {
+			r_actual[i] += rules.snake_r_food_step;
+			len[i] += 1;
+			arena.foods.remove(eaten);
+		}
+	}
+
+	// ---- food generation ----
+	food_counter[i] += elapsed;
+	if (food_counter[i] > rules.food_gen_rate) {
+		food_counter[i] -= rules.food_gen_rate;
+		if (arena.foods.full() && rules.food_cap_policy == FoodPool::DespawnOldest && arena.foods.size() > 0) {
+			arena.foods.remove(arena.foods.oldest());
+		}
+		while (!arena.foods.full()) {
+			float x = arena.arena_x_dist(arena.rng);
+			float y = arena.arena_y_dist(arena.rng);
+			glm::vec2 at = glm::vec2(x, y);
+			if (!obstacles_collide(at, rules.food_r)) {
+				arena.foods.add(at, rules.food_r);
+				break;
+			}
+		}
+	}
+
+	// ---- obstacle movement ----
+	moved.clear();
+	arrived.clear();
+	arena.obstacles.step(elapsed, rules.obs_mv_rate_mod, rules.obs_mv_step_sq, &moved, &arrived);
+	for (uint32_t o : moved) {
+		arena.obstacle_grid.move(o, arena.obstacles.pos(o));
+	}
+	for (uint32_t o : arrived) {
+		arena.obstacles.dest_x[o] = arena.arena_x_dist(arena.rng);
+		arena.obstacles.dest_y[o] = arena.arena_y_dist(arena.rng);
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "SnakeSim.hpp"
+#include "aligned_allocator.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/*
+ * SnakeBatch steps many independent games of Blind Snake in lockstep (e.g., for RL training).
+ *
+ * Each game's head, velocity, radius and timers live in structure-of-arrays "lanes",
+ *  updated with SIMD (see simd.hpp) for every game at once; the parts that vary in size
+ *  (body, obstacles, food) and the game's RNG live in a per-game Arena and are handled game by game.
+ * Games that end are regenerated from the next unused seed at the end of step().
+ *
+ * The rules mirror SnakeSim::update, and a game with the same seed and input plays out
+ *  identically in either; keep the two in sync.
+ */
+
+struct SnakeBatch {
+	//'count' games, seeded first_seed, first_seed + 1, ..., each played with 'settings' (as SnakeSim(seed, settings)):
+	SnakeBatch(uint32_t count, uint32_t first_seed, SnakeState const &settings = SnakeState());
+
+	uint32_t size() const { return count; }
+
+	//same as SnakeSim::steer, for game 'i':
+	void steer(uint32_t i, glm::vec2 const &dir);
+
+	//advance every game by 'elapsed' seconds:
+	void step(float elapsed);
+
+	//----- per-game results of the last step() -----
+	std::vector< uint8_t > ended; //game was over at the end of the step (and has since been reset)
+	std::vector< uint8_t > escaped; //...and it ended by leaving through the exit
+	std::vector< uint32_t > seeds; //seed of each game currently being played
+
+	//----- per-game lanes (padded to a multiple of the SIMD width) -----
+	typedef std::vector< float, AlignedAllocator< float > > Floats;
+	Floats pos_x, pos_y;
+	Floats prev_x, prev_y;
+	Floats vel_x, vel_y;
+	Floats r, r_actual;
+	Floats r_lag_counter, decay_counter, food_counter;
+	Floats body_interval;
+	Floats exit_x, exit_y;
+	std::vector< double > time;
+	std::vector< uint16_t > len;
+	std::vector< uint8_t > mouth_open;
+	std::vector< uint8_t > over;
+
+	//----- per-game variable-size state -----
+	struct Arena {
+		SnakeBody body;
+		Obstacles obstacles;
+		SpatialGrid obstacle_grid;
+		FoodPool foods;
+		SnakeRng rng;
+		SnakeRng::UniformFloat arena_x_dist;
+		SnakeRng::UniformFloat arena_y_dist;
+	};
+	std::vector< Arena > arenas;
+
+	//rule constants (arena size, rates, ...) for every game:
+	SnakeState rules;
+
+	uint32_t count = 0;
+	uint32_t next_seed = 0;
+
+private:
+	//start game 'i' over with seed 'seed':
+	void reset(uint32_t i, uint32_t seed);
+	//the game-by-game part of step():
+	void step_arena(uint32_t i, float elapsed);
+
+	//scratch lists for step_arena:
+	std::vector< uint32_t > nearby, moved, arrived;
+};
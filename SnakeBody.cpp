@@ -0,0 +1,33 @@
+#include "SnakeBody.hpp"
+
+#include <cassert>
+
+SnakeBody::SnakeBody(uint32_t capacity) {
+	uint32_t size = 1;
+	while (size < capacity) size *= 2;
+	ring.resize(size);
+	mask = size - 1;
+}
+
+void SnakeBody::push_back(glm::vec2 const &pos, double born) {
+	if (count == ring.size()) {
+		//full: unroll into a ring twice the size
+		std::vector< Segment > bigger(ring.size() * 2);
+		for (uint32_t i = 0; i < count; ++i) {
+			bigger[i] = (*this)[i];
+		}
+		ring.swap(bigger);
+		mask = uint32_t(ring.size()) - 1;
+		first = 0;
+	}
+	Segment &seg = ring[(first + count) & mask];
+	seg.pos = pos;
+	seg.born = born;
+	++count;
+}
+
+void SnakeBody::trim(uint32_t length) {
+	if (count <= length) return;
+	first = (first + (count - length)) & mask;
+	count = length;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/*
+ * SnakeBody is the trail of segments behind the snake's head, oldest first,
+ *  kept in a power-of-two ring buffer.
+ * Each segment records the sim time it was laid down, so nothing needs to be
+ *  touched as segments age and trimming the tail is O(1).
+ */
+
+struct SnakeBody {
+	struct Segment {
+		glm::vec2 pos;
+		double born; //sim time when this segment was laid down
+	};
+
+	SnakeBody(uint32_t capacity = 16); //capacity is rounded up to a power of two
+
+	uint32_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	//segment 'i' counting from the oldest:
+	Segment const &operator[](uint32_t i) const { return ring[(first + i) & mask]; }
+	//newest segment:
+	Segment const &back() const { return (*this)[count - 1]; }
+
+	//add a newest segment (doubles the ring if it is full):
+	void push_back(glm::vec2 const &pos, double born);
+	//drop oldest segments until at most 'length' remain:
+	void trim(uint32_t length);
+	void clear() { first = count = 0; }
+
+	std::vector< Segment > ring;
+	uint32_t mask = 0; //ring.size() - 1
+	uint32_t first = 0; //ring index of the oldest segment
+	uint32_t count = 0;
+};
@@ -3,101 +3,99 @@
 //for the GL_ERRORS() macro:
 #include "gl_errors.hpp"
 
+//for timing GPU passes:
+#include "Profiler.hpp"
+
 //for glm::value_ptr() :
 #include <glm/gtc/type_ptr.hpp>
 
-#include <random>
-
-SnakeMode::SnakeMode() {
-
-  mt.seed(static_cast<unsigned int>( time(NULL) ));
-  arena_x_dist = std::uniform_real_distribution<float>(
-    arena_pos.x - arena_radius.x + wall_radius,
-    arena_pos.x + arena_radius.x - wall_radius
-  );
-  arena_y_dist = std::uniform_real_distribution<float>(
-    arena_pos.y - arena_radius.y + wall_radius,
-    arena_pos.y + arena_radius.y - wall_radius
-  );
-
-  // generate exit and starting positions
-  {
-    std::uniform_int_distribution<uint32_t> side_dist(0, 3);
-    uint32_t side = side_dist(mt);
-    if (side == 0) {
-      exit_pos.x = arena_pos.x - arena_radius.x;
-      exit_pos.y = arena_y_dist(mt);
-      snake_pos.x = arena_pos.x + arena_radius.x;
-      snake_pos.y = 2.0f * arena_pos.y - exit_pos.y;
-    }
-    else if (side == 1) {
-      exit_pos.x = arena_pos.x + arena_radius.x;
-      exit_pos.y = arena_y_dist(mt);
-      snake_pos.x = arena_pos.x - arena_radius.x;
-      snake_pos.y = 2.0f * arena_pos.y - exit_pos.y;
-    }
-    else if (side == 2) {
-      exit_pos.x = arena_x_dist(mt);
-      exit_pos.y = arena_pos.y - arena_radius.y;
-      snake_pos.x = 2.0f * arena_pos.x - exit_pos.x;
-      snake_pos.y = arena_pos.y + arena_radius.y;
-    }
-    else if (side == 3) {
-      exit_pos.x = arena_x_dist(mt);
-      exit_pos.y = arena_pos.y + arena_radius.y;
-      snake_pos.x = 2.0f * arena_pos.x - exit_pos.x;
-      snake_pos.y = arena_pos.y - arena_radius.y;
-    }
-
-    // clamp to certain buffer
-    snake_pos.x = std::max(snake_pos.x, arena_pos.x - arena_radius.x + snake_start_margin.x);
-    snake_pos.x = std::min(snake_pos.x, arena_pos.x + arena_radius.x - snake_start_margin.x);
-
-    snake_pos.y = std::max(snake_pos.y, arena_pos.y - arena_radius.y + snake_start_margin.y);
-    snake_pos.y = std::min(snake_pos.y, arena_pos.y + arena_radius.y - snake_start_margin.y);
+#include <ctime>
+#include <cassert>
+#include <algorithm>
+#include <cmath>
 
-  }
+//some nice colors from the course web page:
+#define HEX_TO_U8VEC4( HX ) (glm::u8vec4( (HX >> 24) & 0xff, (HX >> 16) & 0xff, (HX >> 8) & 0xff, (HX) & 0xff ))
+//(level colors are used both when building the static level geometry and in draw)
+static const glm::u8vec4 bg_color = HEX_TO_U8VEC4(0xf3ffc6ff);
+static const glm::u8vec4 wall_color = HEX_TO_U8VEC4(0x602020ff);
 
-  // generate snake
-  snake_body.emplace_back(snake_pos, 0.0f);
-
-  // generate obstacles
-  {
-    std::uniform_real_distribution<float> obs_r_dist(obs_r_min, obs_r_max);
-    for (uint32_t i = 0; i < obs_count_init; i++) {
+SnakeMode::SnakeMode() : SnakeMode(static_cast<uint32_t>( time(NULL) )) {
+}
 
-      float x = arena_x_dist(mt);
-      float y = arena_y_dist(mt);
-      float r = obs_r_dist(mt);
-      if (std::abs(snake_pos.x - x) < obs_buffer && std::abs(snake_pos.y - y) < obs_buffer) {
-        continue;
-      }
-      else if (std::abs(exit_pos.x - x) < obs_buffer && std::abs(exit_pos.y - y) < obs_buffer) {
-        continue;
-      }
-      float x1 = arena_x_dist(mt); // the target position
-      float y1 = arena_y_dist(mt);
-      obstacles.emplace_back(glm::vec2(x, y), r, glm::vec2(x1, y1));
-    }
-  }
+SnakeMode::SnakeMode(uint32_t seed) : sim(seed), recording(seed) {
 
 	//----- allocate OpenGL resources -----
-	{ //vertex buffer:
-		glGenBuffers(1, &vertex_buffer);
-		//for now, buffer will be un-filled.
+	{ //level buffer: the walls and exit never move, so they are built and uploaded once
+		std::vector< Vertex > vertices;
+
+		//inline helper function for rectangle drawing:
+		auto draw_rectangle = [&vertices](glm::vec2 const &center, glm::vec2 const &radius, glm::u8vec4 const &color) {
+			//split rectangle into two CCW-oriented triangles:
+			vertices.emplace_back(glm::vec3(center.x-radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
+			vertices.emplace_back(glm::vec3(center.x+radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
+			vertices.emplace_back(glm::vec3(center.x+radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
+
+			vertices.emplace_back(glm::vec3(center.x-radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
+			vertices.emplace_back(glm::vec3(center.x+radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
+			vertices.emplace_back(glm::vec3(center.x-radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
+		};
+
+		//...and circles, as a many-sided polygon (it's only built once, so be generous):
+		auto draw_circle = [&vertices](glm::vec2 const &center, float radius, glm::u8vec4 const &color) {
+			const uint32_t sides = 72;
+			for (uint32_t i = 0; i < sides; ++i) {
+				float a0 = 2.0f * 3.14159265358979f * i / float(sides);
+				float a1 = 2.0f * 3.14159265358979f * ((i + 1) % sides) / float(sides);
+				vertices.emplace_back(glm::vec3(center.x + radius * std::cos(a0), center.y + radius * std::sin(a0), 0.0f), color, glm::vec2(0.5f, 0.5f));
+				vertices.emplace_back(glm::vec3(center.x + radius * std::cos(a1), center.y + radius * std::sin(a1), 0.0f), color, glm::vec2(0.5f, 0.5f));
+				vertices.emplace_back(glm::vec3(center.x, center.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
+			}
+		};
+
+		//floor (texture coordinates span the arena, lower-left origin):
+		{
+			glm::vec2 min = sim.arena_pos - sim.arena_radius;
+			glm::vec2 max = sim.arena_pos + sim.arena_radius;
+			glm::u8vec4 white = glm::u8vec4(0xff);
+			vertices.emplace_back(glm::vec3(min.x, min.y, 0.0f), white, glm::vec2(0.0f, 0.0f));
+			vertices.emplace_back(glm::vec3(max.x, min.y, 0.0f), white, glm::vec2(1.0f, 0.0f));
+			vertices.emplace_back(glm::vec3(max.x, max.y, 0.0f), white, glm::vec2(1.0f, 1.0f));
+
+			vertices.emplace_back(glm::vec3(min.x, min.y, 0.0f), white, glm::vec2(0.0f, 0.0f));
+			vertices.emplace_back(glm::vec3(max.x, max.y, 0.0f), white, glm::vec2(1.0f, 1.0f));
+			vertices.emplace_back(glm::vec3(min.x, max.y, 0.0f), white, glm::vec2(0.0f, 1.0f));
+			level_floor_count = GLsizei(vertices.size());
+		}
+
+		//walls:
+		draw_rectangle(glm::vec2(sim.arena_pos.x - sim.arena_radius.x, sim.arena_pos.y), glm::vec2(sim.wall_radius, sim.arena_radius.y), wall_color);
+		draw_rectangle(glm::vec2(sim.arena_pos.x + sim.arena_radius.x, sim.arena_pos.y), glm::vec2(sim.wall_radius, sim.arena_radius.y), wall_color);
+		draw_rectangle(glm::vec2(sim.arena_pos.x, sim.arena_pos.y - sim.arena_radius.y), glm::vec2(sim.arena_radius.x, sim.wall_radius), wall_color);
+		draw_rectangle(glm::vec2(sim.arena_pos.x, sim.arena_pos.y + sim.arena_radius.y), glm::vec2(sim.arena_radius.x, sim.wall_radius), wall_color);
+
+		//exit (a gap cut in the walls, drawn over them in the background color):
+		draw_circle(sim.exit_pos, sim.wall_radius * 2.0f, bg_color);
+
+		level_vertex_count = GLsizei(vertices.size());
+
+		glGenBuffers(1, &level_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, level_buffer);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertices[0]), vertices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
 	}
 
 	{ //vertex array mapping buffer for color_texture_program:
-		//ask OpenGL to fill vertex_buffer_for_color_texture_program with the name of an unused vertex array object:
-		glGenVertexArrays(1, &vertex_buffer_for_color_texture_program);
+		//ask OpenGL to fill level_buffer_for_color_texture_program with the name of an unused vertex array object:
+		glGenVertexArrays(1, &level_buffer_for_color_texture_program);
 
-		//set vertex_buffer_for_color_texture_program as the current vertex array object:
-		glBindVertexArray(vertex_buffer_for_color_texture_program);
+		//set level_buffer_for_color_texture_program as the current vertex array object:
+		glBindVertexArray(level_buffer_for_color_texture_program);
 
-		//set vertex_buffer as the source of glVertexAttribPointer() commands:
-		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+		//set level_buffer as the source of glVertexAttribPointer() commands:
+		glBindBuffer(GL_ARRAY_BUFFER, level_buffer);
 
 		//set up the vertex array object to describe arrays of SnakeMode::Vertex:
 		glVertexAttribPointer(
@@ -131,7 +129,7 @@ SnakeMode::SnakeMode() {
 		);
 		glEnableVertexAttribArray(color_texture_program.TexCoord_vec2);
 
-		//done referring to vertex_buffer, so unbind it:
+		//done referring to level_buffer, so unbind it:
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 		//done setting up vertex array object, so unbind it:
@@ -140,6 +138,61 @@ SnakeMode::SnakeMode() {
 		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
 	}
 
+	{ //circle mesh + instance buffers, and the vertex arrays mapping them for circle_program and sdf_circle_program:
+		//unit circle as a triangle fan: center, then a 36-gon's corners counterclockwise (repeating the first to close it):
+		const uint32_t sides = 36;
+		std::vector< glm::vec2 > mesh;
+		mesh.emplace_back(0.0f, 0.0f);
+		for (uint32_t i = 0; i <= sides; ++i) {
+			float angle = 3.14159265358979f * (1.0f + 2.0f * (i % sides) / float(sides)); //(starting at (-1,0), like the old vertex circles)
+			mesh.emplace_back(std::cos(angle), std::sin(angle));
+		}
+		circle_mesh_count = GLsizei(mesh.size());
+
+		glGenBuffers(1, &circle_mesh_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, circle_mesh_buffer);
+		glBufferData(GL_ARRAY_BUFFER, mesh.size() * sizeof(mesh[0]), mesh.data(), GL_STATIC_DRAW);
+
+		//unit quad as a triangle strip:
+		const glm::vec2 quad[4] = {
+			glm::vec2(-1.0f,-1.0f), glm::vec2( 1.0f,-1.0f), glm::vec2(-1.0f, 1.0f), glm::vec2( 1.0f, 1.0f)
+		};
+		glGenBuffers(1, &circle_quad_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, circle_quad_buffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+
+		//both programs take corners per-vertex and center, radius, color per-instance:
+		auto map_circle_buffers = [this](GLuint corner_buffer, GLuint Corner_vec2, GLuint Center_vec2, GLuint Radius_float, GLuint Color_vec4) {
+			glBindBuffer(GL_ARRAY_BUFFER, corner_buffer);
+			glVertexAttribPointer(Corner_vec2, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (GLbyte *)0 + 0);
+			glEnableVertexAttribArray(Corner_vec2);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+			//(divisor 1 => advance once per instance, not per vertex)
+			glEnableVertexAttribArray(Center_vec2);
+			glVertexAttribDivisor(Center_vec2, 1);
+			glEnableVertexAttribArray(Radius_float);
+			glVertexAttribDivisor(Radius_float, 1);
+			glEnableVertexAttribArray(Color_vec4);
+			glVertexAttribDivisor(Color_vec4, 1);
+			point_circle_instances(Center_vec2, Radius_float, Color_vec4, 0);
+		};
+
+		glGenVertexArrays(1, &circle_buffers_for_circle_program);
+		glBindVertexArray(circle_buffers_for_circle_program);
+		map_circle_buffers(circle_mesh_buffer,
+			circle_program.Corner_vec2, circle_program.Center_vec2, circle_program.Radius_float, circle_program.Color_vec4);
+
+		glGenVertexArrays(1, &circle_buffers_for_sdf_circle_program);
+		glBindVertexArray(circle_buffers_for_sdf_circle_program);
+		map_circle_buffers(circle_quad_buffer,
+			sdf_circle_program.Corner_vec2, sdf_circle_program.Center_vec2, sdf_circle_program.Radius_float, sdf_circle_program.Color_vec4);
+
+		glBindVertexArray(0);
+
+		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+	}
+
 	{ //solid white texture:
 		//ask OpenGL to fill white_tex with the name of an unused texture object:
 		glGenTextures(1, &white_tex);
@@ -172,16 +225,38 @@ SnakeMode::SnakeMode() {
 SnakeMode::~SnakeMode() {
 
 	//----- free OpenGL resources -----
-	glDeleteBuffers(1, &vertex_buffer);
-	vertex_buffer = 0;
+	//(circle_stream frees itself)
+
+	glDeleteBuffers(1, &level_buffer);
+	level_buffer = 0;
+
+	glDeleteVertexArrays(1, &level_buffer_for_color_texture_program);
+	level_buffer_for_color_texture_program = 0;
+
+	glDeleteBuffers(1, &circle_mesh_buffer);
+	circle_mesh_buffer = 0;
+
+	glDeleteBuffers(1, &circle_quad_buffer);
+	circle_quad_buffer = 0;
 
-	glDeleteVertexArrays(1, &vertex_buffer_for_color_texture_program);
-	vertex_buffer_for_color_texture_program = 0;
+	glDeleteVertexArrays(1, &circle_buffers_for_circle_program);
+	circle_buffers_for_circle_program = 0;
+
+	glDeleteVertexArrays(1, &circle_buffers_for_sdf_circle_program);
+	circle_buffers_for_sdf_circle_program = 0;
 
 	glDeleteTextures(1, &white_tex);
 	white_tex = 0;
 }
 
+void SnakeMode::point_circle_instances(GLuint Center_vec2, GLuint Radius_float, GLuint Color_vec4, GLintptr offset) {
+	glBindBuffer(GL_ARRAY_BUFFER, circle_stream.buffer);
+	glVertexAttribPointer(Center_vec2, 2, GL_FLOAT, GL_FALSE, sizeof(CircleInstance), (GLbyte *)0 + offset + 0);
+	glVertexAttribPointer(Radius_float, 1, GL_FLOAT, GL_FALSE, sizeof(CircleInstance), (GLbyte *)0 + offset + 4*2);
+	glVertexAttribPointer(Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(CircleInstance), (GLbyte *)0 + offset + 4*2 + 4);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 bool SnakeMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size) {
 
   if (evt.type == SDL_MOUSEMOTION) {
@@ -191,21 +266,21 @@ bool SnakeMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size
       (evt.motion.y + 0.5f) / window_size.y *-2.0f + 1.0f
     );
 
-    if (clip_mouse.x != 0.0f && clip_mouse.y != 0.0f) {
-      float scaling = snake_speed / std::sqrt(clip_mouse.y * clip_mouse.y + clip_mouse.x * clip_mouse.x);
-      snake_vel = clip_mouse * scaling;
-    }
+    if (!sim.over) recording.steer(clip_mouse);
+    sim.steer(clip_mouse);
 
     return true;
 
   }
   else if (evt.type == SDL_MOUSEBUTTONDOWN && evt.button.button == SDL_BUTTON_LEFT) {
-    snake_mouth_open = false;
+    if (!sim.over) recording.mouth(false);
+    sim.snake_mouth_open = false;
 
     return true;
   }
   else if (evt.type == SDL_MOUSEBUTTONUP && evt.button.button == SDL_BUTTON_LEFT) {
-    snake_mouth_open = true;
+    if (!sim.over) recording.mouth(true);
+    sim.snake_mouth_open = true;
 
     return true;
   }
@@ -214,136 +289,13 @@ bool SnakeMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size
 }
 
 void SnakeMode::update(float elapsed) {
-
-  // ---- snake movement ----
-
-  if (over) return;
-
-  snake_pos_prev = snake_pos;
-
-  snake_pos += snake_vel * elapsed;
-
-  for (auto &s : snake_body) {
-    s.z += elapsed;
-  }
-
-  if (!snake_body.empty() && snake_body.back().z > snake_body_interval) {
-    float dt = snake_body.back().z - snake_body_interval;
-    float scale_front = dt / elapsed;
-    float scale_back = 1.0f - scale_front;
-    snake_body.emplace_back(snake_pos * scale_back + snake_pos_prev * scale_front, dt);
-  }
-
-  while (snake_body.size() > snake_len) {
-    snake_body.pop_front();
-  }
-
-  auto isCirclesCollide = [](glm::vec2 const &c0, float const &r0, glm::vec2 const &c1, float const &r1) {
-    return (c0.x - c1.x) * (c0.x - c1.x) + (c0.y - c1.y) * (c0.y - c1.y) < 0.9f * (r0 + r1) * (r0 + r1);
-  };
-
-  // ---- snake v snake tail collision ----
-
-  for (uint32_t i = 0; i + snake_body_solid_index < snake_body.size(); i++) {
-    if (isCirclesCollide(snake_pos, snake_r, glm::vec2(snake_body[i].x, snake_body[i].y), snake_r)) {
-      over = true;
-    }
-  }
-
-  // ---- snake v obstacle collision ----
-
-  for (struct Obstacle &ob : obstacles) {
-    if (isCirclesCollide(snake_pos, snake_r, ob.pos, ob.r)) {
-      over = true;
-    }
-  }
-
-  // ---- snake v wall collision (except exit area) ----
-
-  if (!isCirclesCollide(snake_pos, snake_r, exit_pos, exit_r)) {
-    if (std::abs(arena_pos.x - snake_pos.x) > arena_radius.x - snake_r - wall_radius ||
-        std::abs(arena_pos.y - snake_pos.y) > arena_radius.y - snake_r - wall_radius) {
-      over = true;
-    }
-  }
-
-  // ---- snake v food collision ----
-  if (snake_mouth_open) {
-    for (std::list<glm::vec3>::iterator i = foods.begin(); i != foods.end(); i++) {
-      glm::vec3 &f = *i;
-      if (isCirclesCollide(snake_pos, snake_r, glm::vec2(f.x, f.y), f.z)) {
-        snake_r_actual += snake_r_food_step;
-        snake_len += 1;
-        foods.erase(i);
-        break;
-      }
-    }
-  }
-
-  // ---- food generation ----
-
-  food_counter += elapsed;
-  if (food_counter > food_gen_rate) {
-    food_counter -= food_gen_rate;
-    bool done = false;
-    while (!done) {
-      float x = arena_x_dist(mt);
-      float y = arena_y_dist(mt);
-      for (struct Obstacle &ob : obstacles) {
-        done = true;
-        if (isCirclesCollide(glm::vec2(x, y), food_r, ob.pos, ob.r)) {
-          done = false;
-        }
-      }
-      if (done) {
-        foods.emplace_back(x, y, food_r);
-      }
-    }
-  }
-
-  // ---- snake growth/decay ----
-  if (std::abs(snake_r_actual - snake_r) > 0.5f * snake_r_lag_step) {
-    snake_r_lag_counter += elapsed;
-    if (snake_r_lag_counter > snake_r_lag_rate) {
-      snake_r_lag_counter -= snake_r_lag_rate;
-      if (snake_r_actual > snake_r) snake_r += snake_r_lag_step;
-      else snake_r -= snake_r_lag_step;
-      snake_body_interval = snake_r;
-    }
-  }
-  if (snake_r_actual > snake_r_min) {
-    snake_decay_counter += elapsed;
-    if (snake_decay_counter > snake_decay_rate) {
-      snake_decay_counter -= snake_decay_rate;
-      snake_r_actual -= snake_decay_step;
-    }
-  }
-
-  // ---- obstacle movement ----
-  for (struct Obstacle &ob : obstacles) {
-    ob.mv_timer += elapsed;
-    if (ob.mv_timer > ob.r * obs_mv_rate_mod) {
-      ob.mv_timer -= ob.r;
-      glm::vec2 dir = ob.dest - ob.pos;
-      float dist_sq = dir.x * dir.x + dir.y * dir.y;
-      if (dist_sq < obs_mv_step_sq) {
-        ob.dest = glm::vec2(arena_x_dist(mt), arena_y_dist(mt));
-      }
-      else {
-        float scaling = obs_mv_step_sq / std::sqrt(dist_sq);
-        ob.pos += dir * scaling;
-      }
-    }
-
-  }
+  if (!sim.over) recording.update(elapsed);
+  sim.update(elapsed);
 }
 
 void SnakeMode::draw(glm::uvec2 const &drawable_size) {
-	//some nice colors from the course web page:
-	#define HEX_TO_U8VEC4( HX ) (glm::u8vec4( (HX >> 24) & 0xff, (HX >> 16) & 0xff, (HX >> 8) & 0xff, (HX) & 0xff ))
-	const glm::u8vec4 bg_color = HEX_TO_U8VEC4(0xf3ffc6ff);
+	//more nice colors from the course web page:
 	const glm::u8vec4 fg_color = HEX_TO_U8VEC4(0x000040ff);
-	const glm::u8vec4 wall_color = HEX_TO_U8VEC4(0x602020ff);
 	const glm::u8vec4 food_color = HEX_TO_U8VEC4(0xff4040ff);
 	// const glm::u8vec4 obstacle_color = HEX_TO_U8VEC4(0x804040ff);
 	// const glm::u8vec4 white_color = HEX_TO_U8VEC4(0xffffffff);
@@ -361,104 +313,16 @@ void SnakeMode::draw(glm::uvec2 const &drawable_size) {
 	};
 	#undef HEX_TO_U8VEC4
 
-	//---- compute vertices to draw ----
-
-	//vertices will be accumulated into this list and then uploaded+drawn at the end of this function:
-	std::vector< Vertex > vertices;
-
-	//inline helper function for rectangle drawing:
-	auto draw_rectangle = [&vertices](glm::vec2 const &center, glm::vec2 const &radius, glm::u8vec4 const &color) {
-		//split rectangle into two CCW-oriented triangles:
-		vertices.emplace_back(glm::vec3(center.x-radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(center.x+radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(center.x+radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-
-		vertices.emplace_back(glm::vec3(center.x-radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(center.x+radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(center.x-radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-	};
-
-  auto draw_circle = [&vertices](glm::vec2 const &center, float const &radius, glm::u8vec4 const &color) {
-
-    static const uint8_t sides = 36;
-    static const float x_offsets[sides+1] =
-      {-1.0f, -0.98480775301f, -0.93969262078f, -0.86602540378f, -0.76604444311f,
-        -0.64278760968f, -0.5f, -0.34202014332f, -0.17364817766f,
-        0.0f, 0.17364817766f, 0.34202014332f, 0.5f, 0.64278760968f,
-        0.76604444311f, 0.86602540378f, 0.93969262078f, 0.98480775301f,
-        1.0f,  0.98480775301f,  0.93969262078f,  0.86602540378f, 0.76604444311f,
-        0.64278760968f, 0.5f, 0.34202014332f, 0.17364817766f,
-        0.0f, -0.17364817766f, -0.34202014332f, -0.5f, -0.64278760968f,
-        -0.76604444311f, -0.86602540378f, -0.93969262078f, -0.98480775301f, -1.0f
-      };
-
-    static const float y_offsets[sides+1] =
-      {0.0f, -0.17364817766f, -0.34202014332f, -0.5f, -0.64278760968f,
-        -0.76604444311f, -0.86602540378f, -0.93969262078f, -0.98480775301f,
-        -1.0f, -0.98480775301f, -0.93969262078f, -0.86602540378f, -0.76604444311f,
-        -0.64278760968f, -0.5f, -0.34202014332f, -0.17364817766f,
-        0.0f, 0.17364817766f, 0.34202014332f, 0.5f, 0.64278760968f,
-        0.76604444311f, 0.86602540378f, 0.93969262078f, 0.98480775301f,
-        1.0f,  0.98480775301f,  0.93969262078f,  0.86602540378f, 0.76604444311f,
-        0.64278760968f, 0.5f, 0.34202014332f, 0.17364817766f, 0.0f
-      };
-
-    //just draw a <sides>-gon with CCW-oriented triangles:
-    for (uint8_t i = 0; i < sides; i++) {
-      vertices.emplace_back(glm::vec3(center.x+x_offsets[i]*radius, center.y+y_offsets[i]*radius, 0.0f), color, glm::vec2(0.5f, 0.5f));
-      vertices.emplace_back(glm::vec3(center.x+x_offsets[i+1]*radius, center.y+y_offsets[i+1]*radius, 0.0f), color, glm::vec2(0.5f, 0.5f));
-      vertices.emplace_back(glm::vec3(center.x, center.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-    }
-
-  };
-
-  { // ---- draw walls ----
-    draw_rectangle(glm::vec2(arena_pos.x - arena_radius.x, arena_pos.y), glm::vec2(wall_radius, arena_radius.y), wall_color);
-    draw_rectangle(glm::vec2(arena_pos.x + arena_radius.x, arena_pos.y), glm::vec2(wall_radius, arena_radius.y), wall_color);
-    draw_rectangle(glm::vec2(arena_pos.x, arena_pos.y - arena_radius.y), glm::vec2(arena_radius.x, wall_radius), wall_color);
-    draw_rectangle(glm::vec2(arena_pos.x, arena_pos.y + arena_radius.y), glm::vec2(arena_radius.x, wall_radius), wall_color);
-  }
-
-  { // ---- draw exit ----
-    draw_circle(exit_pos, wall_radius * 2.0f, bg_color);
-  }
-
-  { // ---- draw snake ----
-
-    uint32_t color_index = 0;
-    for (auto bi = snake_body.rbegin(); bi != snake_body.rend(); bi++) {
-      draw_circle(glm::vec2(bi->x, bi->y), snake_r, rainbow_colors[color_index]);
-      color_index++;
-      if (color_index >= rainbow_colors.size()) color_index = 0;
-    }
-
-    draw_circle(snake_pos, snake_r, fg_color);
-
-    // snake eyes
-    // float eye_scale = snake_r / snake_speed;
-    // draw_circle(snake_pos);
-
-  }
-
-  { // ---- draw food ----
-    for (glm::vec3 f : foods) {
-      draw_circle(glm::vec2(f.x, f.y), f.z, food_color);
-    }
-  }
-
-  { // ---- draw obstacles ----
-    uint32_t i = 0;
-    for (struct Obstacle &ob : obstacles) {
-      draw_circle(ob.pos, ob.r, obstacle_colors[i]);
-      i++;
-      if (i >= obstacle_colors.size()) i = 0;
-    }
-  }
+  //in fixed-step mode, draw everything part way between the last two updates:
+  float alpha = (sim.over ? 1.0f : tick_alpha);
+  glm::vec2 head_pos = glm::mix(sim.snake_pos_prev, sim.snake_pos, alpha);
+  // (the sim time the head is drawn at: body segments laid down after it would be ahead of the head)
+  double draw_time = sim.time - double(1.0f - alpha) * double(tick);
 
 	//------ compute court-to-window transform ------
   //compute area that should be visible:
-  glm::vec2 scene_min = arena_pos - arena_radius;
-  glm::vec2 scene_max = arena_pos + arena_radius;
+  glm::vec2 scene_min = sim.arena_pos - sim.arena_radius;
+  glm::vec2 scene_max = sim.arena_pos + sim.arena_radius;
 
   //compute window aspect ratio:
   float aspect = drawable_size.x / float(drawable_size.y);
@@ -466,16 +330,16 @@ void SnakeMode::draw(glm::uvec2 const &drawable_size) {
 
   //compute scale factor for court given that...
   float scale =  2.0f / snake_fovx_small;
-  glm::vec2 camera_pos = snake_pos;
-  if (over) {
+  glm::vec2 camera_pos = head_pos;
+  if (sim.over) {
     scale = std::min(
       (2.0f * aspect) / (scene_max.x - scene_min.x), //... x must fit in [-aspect,aspect] ...
       (2.0f) / (scene_max.y - scene_min.y) //... y must fit in [-1,1].
     );
-    camera_pos = arena_pos;
+    camera_pos = sim.arena_pos;
   }
   else {
-    if (snake_mouth_open) {
+    if (sim.snake_mouth_open) {
       scale = 2.0f / snake_fovx_large;
     }
   }
@@ -490,15 +354,92 @@ void SnakeMode::draw(glm::uvec2 const &drawable_size) {
   //NOTE: glm matrices are specified in *Column-Major* order,
   // so this matrix is actually transposed from how it appears.
 
+  //size of a pixel in arena units:
+  float pixel_size = 2.0f / (scale * drawable_size.y);
+
   //also build the matrix that takes clip coordinates to court coordinates (used for mouse handling):
   clip_to_arena = glm::mat3x2(
     glm::vec2(aspect / scale, 0.0f),
     glm::vec2(0.0f, 1.0f / scale),
-    snake_pos
+    head_pos
   );
 
+	//------ find what is on screen ------
+  //the view rectangle (grown by a pixel, since antialiased circles reach a bit past their radius):
+  glm::vec2 view_radius = glm::vec2(aspect / scale, 1.0f / scale) + glm::vec2(pixel_size);
+  view.cull(sim, camera_pos - view_radius, camera_pos + view_radius);
+
+	//---- compute vertices to draw ----
+
+	//circles are written straight into this frame's region of circle_stream
+	// (and drawn at the end of this function), so count them first:
+	const uint32_t max_circles = (sim.snake_body.size() + 1) + uint32_t(view.foods.size() + view.obstacles.size()); //(snake, food, obstacles)
+
+	if (Profiler::current) Profiler::current->begin(Profiler::UploadPass);
+	CircleInstance *circles = reinterpret_cast< CircleInstance * >(circle_stream.map(max_circles * sizeof(CircleInstance)));
+	uint32_t circle_count = 0;
+
+  //circles are drawn (after the level geometry) as instances:
+  auto draw_circle = [&](glm::vec2 const &center, float const &radius, glm::u8vec4 const &color) {
+    assert(circle_count < max_circles);
+    circles[circle_count++] = CircleInstance(center, radius, color);
+  };
+
+  //(walls and exit are in level_buffer)
+
+  { // ---- draw snake ----
+
+    uint32_t color_index = 0;
+    for (uint32_t b = sim.snake_body.size(); b-- > 0; ) {
+      if (sim.snake_body[b].born <= draw_time && view.contains(sim.snake_body[b].pos, sim.snake_r)) {
+        draw_circle(sim.snake_body[b].pos, sim.snake_r, rainbow_colors[color_index]);
+      }
+      color_index++;
+      if (color_index >= rainbow_colors.size()) color_index = 0;
+    }
+
+    draw_circle(head_pos, sim.snake_r, fg_color);
+
+    // snake eyes
+    // float eye_scale = sim.snake_r / sim.snake_speed;
+    // draw_circle(sim.snake_pos);
+
+  }
+
+  { // ---- draw food ----
+    for (uint32_t i : view.foods) {
+      glm::vec3 const &f = sim.foods[i];
+      draw_circle(glm::vec2(f.x, f.y), f.z, food_color);
+    }
+  }
+
+  { // ---- draw obstacles ----
+    //obstacles that stepped in the last update are drawn part way back along the step
+    // (step() moves straight toward dest by obs_mv_step_sq, so the old position is that far back along the same line);
+    // food doesn't move, so it needs nothing like this.
+    // (view.obstacles and sim.obstacle_moved are both in increasing order, so walk them together)
+    auto moved = sim.obstacle_moved.begin();
+    for (uint32_t o : view.obstacles) {
+      glm::vec2 pos = sim.obstacles.pos(o);
+      while (moved != sim.obstacle_moved.end() && *moved < o) ++moved;
+      if (alpha < 1.0f && moved != sim.obstacle_moved.end() && *moved == o) {
+        glm::vec2 to_dest = sim.obstacles.dest(o) - pos;
+        glm::vec2 pos_prev = pos - to_dest * (sim.obs_mv_step_sq / glm::length(to_dest));
+        pos = glm::mix(pos_prev, pos, alpha);
+      }
+      draw_circle(pos, sim.obstacles.r[o], obstacle_colors[o % obstacle_colors.size()]);
+    }
+  }
+
 	//---- actual drawing ----
 
+	//done writing circles:
+	// (if the driver lost the mapping's contents -- e.g., on a display mode change -- skip drawing them this frame)
+	if (!circle_stream.unmap(circle_count * sizeof(CircleInstance))) circle_count = 0;
+	if (Profiler::current) Profiler::current->end(Profiler::UploadPass);
+
+	Profiler::Scope profile_draw(Profiler::DrawPass);
+
 	//clear the color buffer:
 	glClearColor(bg_color.r / 255.0f, bg_color.g / 255.0f, bg_color.b / 255.0f, bg_color.a / 255.0f);
 	glClear(GL_COLOR_BUFFER_BIT);
@@ -509,36 +450,58 @@ void SnakeMode::draw(glm::uvec2 const &drawable_size) {
 	//don't use the depth test:
 	glDisable(GL_DEPTH_TEST);
 
-	//upload vertices to vertex_buffer:
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer); //set vertex_buffer as current
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertices[0]), vertices.data(), GL_STREAM_DRAW); //upload vertices array
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
 	//set color_texture_program as current program:
 	glUseProgram(color_texture_program.program);
 
 	//upload OBJECT_TO_CLIP to the proper uniform location:
 	glUniformMatrix4fv(color_texture_program.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(arena_to_clip));
 
-	//use the mapping vertex_buffer_for_color_texture_program to fetch vertex data:
-	glBindVertexArray(vertex_buffer_for_color_texture_program);
+	//use the mapping level_buffer_for_color_texture_program to fetch vertex data:
+	glBindVertexArray(level_buffer_for_color_texture_program);
 
-	//bind the solid white texture to location zero:
 	glActiveTexture(GL_TEXTURE0);
+
+	//floor art, if any:
+	if (floor_tex) {
+		glBindTexture(GL_TEXTURE_2D, floor_tex);
+		glDrawArrays(GL_TRIANGLES, 0, level_floor_count);
+	}
+
+	//bind the solid white texture to location zero:
 	glBindTexture(GL_TEXTURE_2D, white_tex);
 
-	//run the OpenGL pipeline:
-	glDrawArrays(GL_TRIANGLES, 0, GLsizei(vertices.size()));
+	//run the OpenGL pipeline (walls + exit, in one call):
+	glDrawArrays(GL_TRIANGLES, level_floor_count, level_vertex_count - level_floor_count);
 
 	//unbind the solid white texture:
 	glBindTexture(GL_TEXTURE_2D, 0);
 
+	//---- circles (instanced) ----
+
+	//one fan or quad per circle, in the order they were added (so later circles still draw over earlier ones):
+	if (circle_style == SdfCircles) {
+		glUseProgram(sdf_circle_program.program);
+		glUniformMatrix4fv(sdf_circle_program.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(arena_to_clip));
+		glUniform1f(sdf_circle_program.PIXEL_SIZE_float, pixel_size);
+		glBindVertexArray(circle_buffers_for_sdf_circle_program);
+		point_circle_instances(sdf_circle_program.Center_vec2, sdf_circle_program.Radius_float, sdf_circle_program.Color_vec4, circle_stream.offset);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(circle_count));
+	} else {
+		glUseProgram(circle_program.program);
+		glUniformMatrix4fv(circle_program.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(arena_to_clip));
+		glBindVertexArray(circle_buffers_for_circle_program);
+		point_circle_instances(circle_program.Center_vec2, circle_program.Radius_float, circle_program.Color_vec4, circle_stream.offset);
+		glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, circle_mesh_count, GLsizei(circle_count));
+	}
+
 	//reset vertex array to none:
 	glBindVertexArray(0);
 
 	//reset current program to none:
 	glUseProgram(0);
 
+	//the GPU may read this frame's circle_stream region until this fence passes:
+	circle_stream.fence();
 
 	GL_ERRORS(); //PARANOIA: print errors just in case we did something wrong.
 
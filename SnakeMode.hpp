@@ -1,21 +1,24 @@
 #include "ColorTextureProgram.hpp"
+#include "CircleProgram.hpp"
+#include "SdfCircleProgram.hpp"
+#include "StreamBuffer.hpp"
 
+#include "SnakeSim.hpp"
+#include "CircleView.hpp"
+#include "Replay.hpp"
 #include "Mode.hpp"
 #include "GL.hpp"
 
 #include <vector>
-#include <deque>
-#include <list>
-#include <cmath>
-#include <ctime>
-#include <random>
 
 /*
- * SnakeMode is a game mode that implements a single-player game of Snake.
+ * SnakeMode is a game mode that plays a single-player game of Snake.
+ * The game itself lives in 'sim' (see SnakeSim.hpp); SnakeMode handles input and drawing.
  */
 
 struct SnakeMode : Mode {
-	SnakeMode();
+	SnakeMode(); //seeds from the current time
+	SnakeMode(uint32_t seed);
 	virtual ~SnakeMode();
 
 	//functions called by main loop:
@@ -25,72 +28,23 @@ struct SnakeMode : Mode {
 
 	//----- game state -----
 
-  glm::vec2 snake_pos = glm::vec2(0.0f, 0.0f);
-  glm::vec2 snake_vel = glm::vec2(1.0f, 0.0f);
+  SnakeSim sim;
 
-  float snake_speed = 1.0f;
-  float snake_r = 0.2f;
-  float snake_r_actual = snake_r;
-  float snake_r_lag_counter = 0.0f;
-  float snake_r_lag_rate = 0.1f;
-  float snake_r_lag_step = 0.005f;
+  //every input the game has reacted to so far (main saves it with --record):
+  Replay recording;
 
-  float snake_r_food_step = 0.04f;
-
-  uint16_t snake_len = 15;
-
-  glm::vec2 snake_pos_prev = glm::vec2(0.0f, 0.0f);
-  float snake_body_interval = 0.2f;
-  std::deque<glm::vec3> snake_body; // (x, y, age)
-
-  uint32_t snake_body_solid_index = 6;
-
-  bool snake_mouth_open = true;
   float snake_fovx_large = 5.0f;
   float snake_fovx_small = 1.0f;
 
-  float snake_decay_counter = 0.0f;
-  float snake_decay_rate = 8.0f;
-  float snake_decay_step = 0.01f;
-  float snake_r_min = 0.15f;
-
-  struct Obstacle {
-    Obstacle(glm::vec2 const &pos_, float const &r_, glm::vec2 const &dest_) :
-      pos(pos_), r(r_), dest(dest_) { }
-    glm::vec2 pos;
-    float r;
-    glm::vec2 dest;
-    float mv_timer = 0.0f;
+  //how circles are drawn:
+  enum CircleStyle : uint8_t {
+    FanCircles, //36-sided polygons
+    SdfCircles, //quads with an antialiased edge computed per-pixel
   };
+  CircleStyle circle_style = FanCircles;
 
-  std::vector<Obstacle> obstacles;
-  uint32_t obs_count_init = 60;
-  float obs_r_max = 1.6f;
-  float obs_r_min = 0.5f;
-  float obs_buffer = 1.0f;
-  float obs_mv_step_sq = 0.015f;
-  float obs_mv_rate_mod = 0.15f;
-
-  float food_gen_rate = 0.35f;
-  float food_counter = 0.0f;
-  float food_r = 0.1f;
-  std::list<glm::vec3> foods; // (x, y, r)
-
-  glm::vec2 arena_radius = glm::vec2(10.0f, 10.0f);
-  glm::vec2 arena_pos = glm::vec2(0.0f, 0.0f);
-  glm::vec2 snake_start_margin = glm::vec2(1.0f, 1.0f);
-
-  float wall_radius = 0.2f;
-  glm::vec2 exit_pos = glm::vec2(0.0f, 0.0f);
-  float exit_r = 0.4f;
-
-  bool over = false;
-
-  // generators
-
-  std::mt19937 mt;
-  std::uniform_real_distribution<float> arena_x_dist;
-  std::uniform_real_distribution<float> arena_y_dist;
+  //what draw() found on screen this frame:
+  CircleView view;
 
 	//----- opengl assets / helpers ------
 
@@ -107,15 +61,50 @@ struct SnakeMode : Mode {
 	//Shader program that draws transformed, vertices tinted with vertex colors:
 	ColorTextureProgram color_texture_program;
 
-	//Buffer used to hold vertex data during drawing:
-	GLuint vertex_buffer = 0;
+	//Buffer holding the level's static geometry (floor, walls, and exit), built once by the constructor:
+	GLuint level_buffer = 0;
+	GLsizei level_vertex_count = 0;
+	GLsizei level_floor_count = 0; //(the first vertices are the floor quad, drawn only with floor_tex)
 
-	//Vertex Array Object that maps buffer locations to color_texture_program attribute locations:
-	GLuint vertex_buffer_for_color_texture_program = 0;
+	//Vertex Array Object that maps level_buffer locations to color_texture_program attribute locations:
+	GLuint level_buffer_for_color_texture_program = 0;
+
+	//circles are drawn instanced: one static mesh (fan or quad, per circle_style), plus one of these per circle:
+	// (CircleInstance, from CircleView.hpp)
+
+	//Shader program that draws instanced circles:
+	CircleProgram circle_program;
+
+	//Shader program that draws instanced circles as antialiased quads:
+	SdfCircleProgram sdf_circle_program;
+
+	//Buffer holding the unit-circle mesh (a triangle fan of glm::vec2 corners):
+	GLuint circle_mesh_buffer = 0;
+	GLsizei circle_mesh_count = 0;
+
+	//Buffer holding the unit quad for sdf_circle_program (a triangle strip of glm::vec2 corners):
+	GLuint circle_quad_buffer = 0;
+
+	//Buffer that draw() writes each frame's CircleInstance data into:
+	StreamBuffer circle_stream{ 1024 * sizeof(CircleInstance), sizeof(CircleInstance) };
+
+	//Vertex Array Object that maps circle_mesh_buffer + circle_stream to circle_program attribute locations:
+	GLuint circle_buffers_for_circle_program = 0;
+
+	//Vertex Array Object that maps circle_quad_buffer + circle_stream to sdf_circle_program attribute locations:
+	GLuint circle_buffers_for_sdf_circle_program = 0;
+
+	//point the bound vertex array's per-instance attributes at CircleInstances starting 'offset' bytes into circle_stream:
+	// (GL 3.3 has no base-instance draws, so this is redone each frame as the stream moves through its regions)
+	void point_circle_instances(GLuint Center_vec2, GLuint Radius_float, GLuint Color_vec4, GLintptr offset);
 
 	//Solid white texture:
 	GLuint white_tex = 0;
 
+	//Arena floor art, stretched over the arena under the walls (0 => none, just the background color):
+	// (not owned; main loads it with a TextureLoader for --floor)
+	GLuint floor_tex = 0;
+
 	//matrix that maps from clip coordinates to court-space coordinates:
 	glm::mat3x2 clip_to_arena = glm::mat3x2(1.0f);
 	// computed in draw() as the inverse of OBJECT_TO_CLIP
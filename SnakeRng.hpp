@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * SnakeRng is the game's random number generator: PCG32 (see pcg-random.org), with 16 bytes of state.
+ * Unlike std::mt19937 (2.5KB) + std:: distributions, it is cheap to copy and produces
+ *  the same numbers with every compiler and standard library, so seeds mean the same thing everywhere.
+ */
+
+struct SnakeRng {
+	SnakeRng() = default;
+	explicit SnakeRng(uint64_t seed_) { seed(seed_); }
+
+	void seed(uint64_t seed_) {
+		state = 0;
+		(*this)();
+		state += seed_;
+		(*this)();
+	}
+
+	//next 32 random bits:
+	uint32_t operator()() {
+		uint64_t old = state;
+		state = old * 6364136223846793005ULL + Increment;
+		uint32_t xorshifted = uint32_t(((old >> 18u) ^ old) >> 27u);
+		uint32_t rot = uint32_t(old >> 59u);
+		return (xorshifted >> rot) | (xorshifted << ((32u - rot) & 31u));
+	}
+
+	//uniform float in [0,1):
+	float unit() {
+		return float((*this)() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	//drop-in replacements for the std:: distributions the game used:
+	struct UniformFloat {
+		UniformFloat() = default;
+		UniformFloat(float min_, float max_) : min(min_), max(max_) { }
+		float operator()(SnakeRng &rng) const { return min + (max - min) * rng.unit(); }
+		float min = 0.0f, max = 1.0f;
+	};
+	struct UniformInt { //inclusive range, like std::uniform_int_distribution
+		UniformInt() = default;
+		UniformInt(uint32_t min_, uint32_t max_) : min(min_), max(max_) { }
+		uint32_t operator()(SnakeRng &rng) const {
+			uint64_t span = uint64_t(max) - min + 1;
+			return min + uint32_t((uint64_t(rng()) * span) >> 32); //(slightly biased for huge spans; fine for the game)
+		}
+		uint32_t min = 0, max = 0;
+	};
+
+	static const uint64_t Increment = 1442695040888963407ULL;
+	uint64_t state = 0x853c49e6748fea9bULL;
+};
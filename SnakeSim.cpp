@@ -0,0 +1,416 @@
+#include "SnakeSim.hpp"
+
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <atomic>
+#include <cstring>
+
+SnakeSim::SnakeSim(uint32_t seed, SnakeState const &settings) : SnakeState(settings) {
+
+  for (uint32_t s = 0; s < SectionCount; s++) {
+    touch(Section(s));
+  }
+
+  rng.seed(seed);
+  arena_x_dist = SnakeRng::UniformFloat(
+    arena_pos.x - arena_radius.x + wall_radius,
+    arena_pos.x + arena_radius.x - wall_radius
+  );
+  arena_y_dist = SnakeRng::UniformFloat(
+    arena_pos.y - arena_radius.y + wall_radius,
+    arena_pos.y + arena_radius.y - wall_radius
+  );
+
+  // generate exit and starting positions
+  {
+    SnakeRng::UniformInt side_dist(0, 3);
+    uint32_t side = side_dist(rng);
+    if (side == 0) {
+      exit_pos.x = arena_pos.x - arena_radius.x;
+      exit_pos.y = arena_y_dist(rng);
+      snake_pos.x = arena_pos.x + arena_radius.x;
+      snake_pos.y = 2.0f * arena_pos.y - exit_pos.y;
+    }
+    else if (side == 1) {
+      exit_pos.x = arena_pos.x + arena_radius.x;
+      exit_pos.y = arena_y_dist(rng);
+      snake_pos.x = arena_pos.x - arena_radius.x;
+      snake_pos.y = 2.0f * arena_pos.y - exit_pos.y;
+    }
+    else if (side == 2) {
+      exit_pos.x = arena_x_dist(rng);
+      exit_pos.y = arena_pos.y - arena_radius.y;
+      snake_pos.x = 2.0f * arena_pos.x - exit_pos.x;
+      snake_pos.y = arena_pos.y + arena_radius.y;
+    }
+    else if (side == 3) {
+      exit_pos.x = arena_x_dist(rng);
+      exit_pos.y = arena_pos.y + arena_radius.y;
+      snake_pos.x = 2.0f * arena_pos.x - exit_pos.x;
+      snake_pos.y = arena_pos.y - arena_radius.y;
+    }
+
+    // clamp to certain buffer
+    snake_pos.x = std::max(snake_pos.x, arena_pos.x - arena_radius.x + snake_start_margin.x);
+    snake_pos.x = std::min(snake_pos.x, arena_pos.x + arena_radius.x - snake_start_margin.x);
+
+    snake_pos.y = std::max(snake_pos.y, arena_pos.y - arena_radius.y + snake_start_margin.y);
+    snake_pos.y = std::min(snake_pos.y, arena_pos.y + arena_radius.y - snake_start_margin.y);
+
+  }
+
+  // generate snake
+  snake_body = SnakeBody(snake_len + 1u);
+  snake_body.push_back(snake_pos, time);
+
+  // generate obstacles
+  {
+    SnakeRng::UniformFloat obs_r_dist(obs_r_min, obs_r_max);
+    for (uint32_t i = 0; i < obs_count_init; i++) {
+
+      float x = arena_x_dist(rng);
+      float y = arena_y_dist(rng);
+      float r = obs_r_dist(rng);
+      if (std::abs(snake_pos.x - x) < obs_buffer && std::abs(snake_pos.y - y) < obs_buffer) {
+        continue;
+      }
+      else if (std::abs(exit_pos.x - x) < obs_buffer && std::abs(exit_pos.y - y) < obs_buffer) {
+        continue;
+      }
+      float x1 = arena_x_dist(rng); // the target position
+      float y1 = arena_y_dist(rng);
+      obstacles.push_back(glm::vec2(x, y), r, glm::vec2(x1, y1));
+    }
+  }
+
+  // bucket obstacles for collision lookups; set up the (empty) food pool on the same cells
+  {
+    glm::vec2 min = arena_pos - arena_radius;
+    glm::vec2 max = arena_pos + arena_radius;
+    obstacle_grid = SpatialGrid(min, max, grid_cell_size);
+    foods = FoodPool(food_cap, obstacle_grid);
+    for (uint32_t i = 0; i < obstacles.size(); i++) {
+      obstacle_grid.insert(i, obstacles.pos(i));
+    }
+  }
+}
+
+void SnakeSim::steer(glm::vec2 const &dir) {
+  if (dir.x != 0.0f && dir.y != 0.0f) {
+    float scaling = snake_speed / std::sqrt(dir.y * dir.y + dir.x * dir.x);
+    snake_vel = dir * scaling;
+  }
+}
+
+void SnakeSim::update(float elapsed) {
+  TRACE_ZONE("SnakeSim::update");
+
+  // ---- snake movement ----
+
+  if (over) return;
+
+  {
+    TRACE_DETAIL_ZONE("movement");
+    snake_pos_prev = snake_pos;
+
+    snake_pos += snake_vel * elapsed;
+
+    time += elapsed;
+
+    if (!snake_body.empty() && float(time - snake_body.back().born) > snake_body_interval) {
+      float dt = float(time - snake_body.back().born) - snake_body_interval;
+      float scale_front = dt / elapsed;
+      float scale_back = 1.0f - scale_front;
+      snake_body.push_back(snake_pos * scale_back + snake_pos_prev * scale_front, time - dt);
+      touch(BodySection);
+    }
+
+    if (snake_body.size() > snake_len) {
+      snake_body.trim(snake_len);
+      touch(BodySection);
+    }
+  }
+
+  // ---- snake v snake tail collision ----
+  {
+    TRACE_DETAIL_ZONE("tail collision");
+    for (uint32_t i = 0; i + snake_body_solid_index < snake_body.size(); i++) {
+      if (isCirclesCollide(snake_pos, snake_r, snake_body[i].pos, snake_r)) {
+        over = true;
+      }
+    }
+  }
+
+  // ---- snake v obstacle collision ----
+  {
+    TRACE_DETAIL_ZONE("obstacle collision");
+    if (obstacles_collide(snake_pos, snake_r)) {
+      over = true;
+    }
+  }
+
+  // ---- snake v wall collision (except exit area) ----
+
+  if (!isCirclesCollide(snake_pos, snake_r, exit_pos, exit_r)) {
+    if (std::abs(arena_pos.x - snake_pos.x) > arena_radius.x - snake_r - wall_radius ||
+        std::abs(arena_pos.y - snake_pos.y) > arena_radius.y - snake_r - wall_radius) {
+      over = true;
+    }
+  }
+
+  // ---- snake v food collision ----
+  if (snake_mouth_open) {
+    glm::vec2 reach = glm::vec2(snake_r + food_r);
+    uint32_t eaten = SpatialGrid::None;
+    foods.grid.any(snake_pos - reach, snake_pos + reach, [&](uint32_t i) {
+      glm::vec3 const &f = foods[i];
+      if (isCirclesCollide(snake_pos, snake_r, glm::vec2(f.x, f.y), f.z)) {
+        eaten = i;
+        return true;
+      }
+      return false;
+    });
+    if (eaten != SpatialGrid::None) {
+      snake_r_actual += snake_r_food_step;
+      snake_len += 1;
+      foods_eaten += 1;
+      foods.remove(eaten);
+      touch(FoodsSection);
+    }
+  }
+
+  // ---- food generation ----
+  {
+    TRACE_DETAIL_ZONE("food generation");
+    food_counter += elapsed;
+    if (food_counter > food_gen_rate) {
+      food_counter -= food_gen_rate;
+      if (foods.full() && food_cap_policy == FoodPool::DespawnOldest && foods.size() > 0) {
+        foods.remove(foods.oldest());
+        touch(FoodsSection);
+      }
+      while (!foods.full()) {
+        float x = arena_x_dist(rng);
+        float y = arena_y_dist(rng);
+        glm::vec2 at = glm::vec2(x, y);
+        if (!obstacles_collide(at, food_r)) {
+          foods.add(at, food_r);
+          touch(FoodsSection);
+          break;
+        }
+      }
+    }
+  }
+
+  // ---- snake growth/decay ----
+  if (std::abs(snake_r_actual - snake_r) > 0.5f * snake_r_lag_step) {
+    snake_r_lag_counter += elapsed;
+    if (snake_r_lag_counter > snake_r_lag_rate) {
+      snake_r_lag_counter -= snake_r_lag_rate;
+      if (snake_r_actual > snake_r) snake_r += snake_r_lag_step;
+      else snake_r -= snake_r_lag_step;
+      snake_body_interval = snake_r;
+    }
+  }
+  if (snake_r_actual > snake_r_min) {
+    snake_decay_counter += elapsed;
+    if (snake_decay_counter > snake_decay_rate) {
+      snake_decay_counter -= snake_decay_rate;
+      snake_r_actual -= snake_decay_step;
+    }
+  }
+
+  // ---- obstacle movement ----
+  {
+    TRACE_DETAIL_ZONE("obstacle movement");
+    obstacle_moved.clear();
+    obstacle_arrived.clear();
+    obstacles.step(elapsed, obs_mv_rate_mod, obs_mv_step_sq, &obstacle_moved, &obstacle_arrived);
+    if (obstacles.size()) touch(ObstacleTimersSection);
+    if (!obstacle_moved.empty() || !obstacle_arrived.empty()) touch(ObstacleMotionSection);
+    for (uint32_t i : obstacle_moved) {
+      if (obstacle_grid.move(i, obstacles.pos(i))) {
+        touch(ObstacleGridSection);
+      }
+    }
+    for (uint32_t i : obstacle_arrived) {
+      obstacles.dest_x[i] = arena_x_dist(rng);
+      obstacles.dest_y[i] = arena_y_dist(rng);
+    }
+  }
+}
+
+bool SnakeSim::escaped() const {
+  return std::abs(arena_pos.x - snake_pos.x) > arena_radius.x ||
+         std::abs(arena_pos.y - snake_pos.y) > arena_radius.y;
+}
+
+bool SnakeSim::obstacles_collide(glm::vec2 const &center, float r) {
+  glm::vec2 reach = glm::vec2(r + obs_r_max);
+  obstacle_nearby.clear();
+  obstacle_grid.for_each(center - reach, center + reach, [this](uint32_t i) {
+    obstacle_nearby.emplace_back(i);
+  });
+  return obstacles.any_collide(obstacle_nearby.data(), uint32_t(obstacle_nearby.size()), center, r);
+}
+
+// ---- snapshots ----
+
+namespace {
+  //versions come from one counter shared by all sims, so a version number
+  // names the same section contents no matter which sim it was saved from:
+  std::atomic< uint64_t > next_version(1);
+
+  //sections are stored as flat runs of plain-old-data:
+  template< typename T >
+  void put(std::vector< uint8_t > *out, T const *data, size_t count) {
+    size_t at = out->size();
+    out->resize(at + sizeof(T) * count);
+    if (count) std::memcpy(out->data() + at, data, sizeof(T) * count);
+  }
+  template< typename T, typename A >
+  void put_vector(std::vector< uint8_t > *out, std::vector< T, A > const &vec) {
+    uint32_t count = uint32_t(vec.size());
+    put(out, &count, 1);
+    put(out, vec.data(), count);
+  }
+  void put_grid(std::vector< uint8_t > *out, SpatialGrid const &grid) {
+    put(out, &grid.origin, 1);
+    put(out, &grid.inv_cell_size, 1);
+    put(out, &grid.size, 1);
+    put_vector(out, grid.heads);
+    put_vector(out, grid.next);
+    put_vector(out, grid.prev);
+    put_vector(out, grid.cells);
+  }
+
+  struct Reader {
+    Reader(uint8_t const *from, size_t size) : at(from), end(from + size) { }
+    template< typename T >
+    void get(T *data, size_t count) {
+      assert(at + sizeof(T) * count <= end && "snapshot section is truncated");
+      if (count) std::memcpy(data, at, sizeof(T) * count);
+      at += sizeof(T) * count;
+    }
+    template< typename T, typename A >
+    void get_vector(std::vector< T, A > *vec) {
+      uint32_t count = 0;
+      get(&count, 1);
+      vec->resize(count); //(no-op when the size matches, so restoring into a similar game doesn't allocate)
+      get(vec->data(), count);
+    }
+    void get_grid(SpatialGrid *grid) {
+      get(&grid->origin, 1);
+      get(&grid->inv_cell_size, 1);
+      get(&grid->size, 1);
+      get_vector(&grid->heads);
+      get_vector(&grid->next);
+      get_vector(&grid->prev);
+      get_vector(&grid->cells);
+    }
+    uint8_t const *at;
+    uint8_t const *end;
+  };
+}
+
+void SnakeSim::touch(Section section) {
+  versions[section] = next_version.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SnakeSim::save(SnakeSnapshot *into, SnakeSnapshotArena *arena) const {
+  assert(into && arena);
+  into->state = *this;
+
+  //sections saved before the arena was cleared are gone:
+  if (into->generation != arena->generation) {
+    into->generation = arena->generation;
+    for (uint32_t s = 0; s < SectionCount; s++) {
+      into->versions[s] = 0;
+    }
+  }
+
+  std::vector< uint8_t > &out = arena->bytes;
+  for (uint32_t s = 0; s < SectionCount; s++) {
+    if (into->versions[s] == versions[s]) continue;
+    into->versions[s] = versions[s];
+
+    //(appended, never overwritten: other snapshots -- e.g., copies of this one -- may still point at the old section)
+    into->offsets[s] = out.size();
+    if (s == BodySection) {
+      //stored oldest first, without the ring's wrap-around:
+      uint32_t count = snake_body.size();
+      put(&out, &count, 1);
+      for (uint32_t i = 0; i < count; i++) {
+        put(&out, &snake_body[i], 1);
+      }
+    } else if (s == ObstacleShapesSection) {
+      put_vector(&out, obstacles.r);
+    } else if (s == ObstacleMotionSection) {
+      put_vector(&out, obstacles.x);
+      put_vector(&out, obstacles.y);
+      put_vector(&out, obstacles.dest_x);
+      put_vector(&out, obstacles.dest_y);
+    } else if (s == ObstacleTimersSection) {
+      put_vector(&out, obstacles.mv_timer);
+    } else if (s == ObstacleGridSection) {
+      put_grid(&out, obstacle_grid);
+    } else if (s == FoodsSection) {
+      put(&out, &foods.capacity, 1);
+      put(&out, &foods.next_serial, 1);
+      put_vector(&out, foods.foods);
+      put_vector(&out, foods.serials);
+      put_grid(&out, foods.grid);
+    }
+    into->sizes[s] = out.size() - into->offsets[s];
+  }
+}
+
+void SnakeSim::restore(SnakeSnapshot const &from, SnakeSnapshotArena const &arena) {
+  assert(from.generation == arena.generation && "restoring from a snapshot whose arena was cleared (or a different arena)");
+  for (uint32_t s = 0; s < SectionCount; s++) {
+    assert(from.versions[s] != 0 && "restoring from a snapshot that was never saved");
+    assert(from.offsets[s] + from.sizes[s] <= arena.bytes.size() && "snapshot section is outside its arena");
+  }
+
+  static_cast< SnakeState & >(*this) = from.state;
+  obstacle_moved.clear(); //(describes an update that, as far as the restored game is concerned, never happened)
+
+  for (uint32_t s = 0; s < SectionCount; s++) {
+    if (versions[s] == from.versions[s]) continue;
+    versions[s] = from.versions[s];
+
+    Reader in(arena.bytes.data() + from.offsets[s], size_t(from.sizes[s]));
+    if (s == BodySection) {
+      uint32_t count = 0;
+      in.get(&count, 1);
+      if (count > snake_body.ring.size()) {
+        snake_body = SnakeBody(count);
+      }
+      snake_body.first = 0;
+      snake_body.count = count;
+      in.get(snake_body.ring.data(), count);
+    } else if (s == ObstacleShapesSection) {
+      in.get_vector(&obstacles.r);
+    } else if (s == ObstacleMotionSection) {
+      in.get_vector(&obstacles.x);
+      in.get_vector(&obstacles.y);
+      in.get_vector(&obstacles.dest_x);
+      in.get_vector(&obstacles.dest_y);
+    } else if (s == ObstacleTimersSection) {
+      in.get_vector(&obstacles.mv_timer);
+    } else if (s == ObstacleGridSection) {
+      in.get_grid(&obstacle_grid);
+    } else if (s == FoodsSection) {
+      in.get(&foods.capacity, 1);
+      in.get(&foods.next_serial, 1);
+      in.get_vector(&foods.foods);
+      in.get_vector(&foods.serials);
+      in.get_grid(&foods.grid);
+      foods.foods.reserve(foods.capacity); //(the pool promises not to allocate while adding food)
+      foods.serials.reserve(foods.capacity);
+    }
+    assert(in.at == in.end && "snapshot section has trailing bytes");
+  }
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "SpatialGrid.hpp"
+#include "Obstacles.hpp"
+#include "FoodPool.hpp"
+#include "SnakeBody.hpp"
+#include "SnakeRng.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cmath>
+#include <type_traits>
+
+/*
+ * SnakeSim holds the state and rules of one game of Blind Snake.
+ * It does not depend on SDL or OpenGL, so it can be created and stepped
+ * without a window (e.g., for batch rollouts); SnakeMode draws it.
+ *
+ * The fixed-size part of the game (settings, snake, timers, RNG) lives in SnakeState,
+ *  which is trivially copyable; the arrays (body, obstacles, food) live in SnakeSim.
+ * save() / restore() copy a whole game to / from a SnakeSnapshot (whose arrays live in a caller-owned
+ *  SnakeSnapshotArena), e.g. for search-based bots.
+ */
+
+struct SnakeState {
+  //----- game state -----
+
+  glm::vec2 snake_pos = glm::vec2(0.0f, 0.0f);
+  glm::vec2 snake_vel = glm::vec2(1.0f, 0.0f);
+
+  float snake_speed = 1.0f;
+  float snake_r = 0.2f;
+  float snake_r_actual = snake_r;
+  float snake_r_lag_counter = 0.0f;
+  float snake_r_lag_rate = 0.1f;
+  float snake_r_lag_step = 0.005f;
+
+  float snake_r_food_step = 0.04f;
+
+  uint16_t snake_len = 15;
+
+  glm::vec2 snake_pos_prev = glm::vec2(0.0f, 0.0f);
+  float snake_body_interval = 0.2f;
+
+  uint32_t snake_body_solid_index = 6;
+
+  bool snake_mouth_open = true;
+
+  float snake_decay_counter = 0.0f;
+  float snake_decay_rate = 8.0f;
+  float snake_decay_step = 0.01f;
+  float snake_r_min = 0.15f;
+
+  uint32_t obs_count_init = 60;
+  float obs_r_max = 1.6f;
+  float obs_r_min = 0.5f;
+  float obs_buffer = 1.0f;
+  float obs_mv_step_sq = 0.015f;
+  float obs_mv_rate_mod = 0.15f;
+
+  float food_gen_rate = 0.35f;
+  float food_counter = 0.0f;
+  float food_r = 0.1f;
+  uint32_t food_cap = 256; // most foods on the field at once
+  FoodPool::Policy food_cap_policy = FoodPool::DespawnOldest;
+
+  // broadphase cell size for obstacle / food lookups
+  float grid_cell_size = 2.0f;
+
+  glm::vec2 arena_radius = glm::vec2(10.0f, 10.0f);
+  glm::vec2 arena_pos = glm::vec2(0.0f, 0.0f);
+  glm::vec2 snake_start_margin = glm::vec2(1.0f, 1.0f);
+
+  float wall_radius = 0.2f;
+  glm::vec2 exit_pos = glm::vec2(0.0f, 0.0f);
+  float exit_r = 0.4f;
+
+  bool over = false;
+
+  uint32_t foods_eaten = 0;
+
+  double time = 0.0; // total elapsed game time
+
+  // generators
+
+  SnakeRng rng;
+  SnakeRng::UniformFloat arena_x_dist;
+  SnakeRng::UniformFloat arena_y_dist;
+};
+static_assert(std::is_trivially_copyable< SnakeState >::value, "SnakeState should be plain data (it is copied wholesale by save / restore)");
+
+struct SnakeSnapshot;
+struct SnakeSnapshotArena;
+
+struct SnakeSim : SnakeState {
+  //generate a level from 'seed', using the settings (sizes, counts, rates) in 'settings':
+  // (e.g., set obs_count_init and arena_radius to try a bigger level)
+  SnakeSim(uint32_t seed, SnakeState const &settings = SnakeState());
+
+  //point the snake along 'dir' (need not be normalized; zero components are ignored):
+  void steer(glm::vec2 const &dir);
+
+  //advance the game by 'elapsed' seconds:
+  void update(float elapsed);
+
+  //has the head left the arena? (once 'over', tells escaping through the exit apart from crashing)
+  bool escaped() const;
+
+  //the (slightly forgiving) overlap test used for all collisions:
+  static bool isCirclesCollide(glm::vec2 const &c0, float const &r0, glm::vec2 const &c1, float const &r1) {
+    return (c0.x - c1.x) * (c0.x - c1.x) + (c0.y - c1.y) * (c0.y - c1.y) < 0.9f * (r0 + r1) * (r0 + r1);
+  }
+
+  //----- game arrays -----
+
+  SnakeBody snake_body; // oldest first; segment age is time - born
+  Obstacles obstacles;
+  FoodPool foods; // (x, y, r), unordered; buckets itself in foods.grid
+
+  // broadphase: obstacles bucketed by position (ids are indices into 'obstacles').
+  // lookups grow their query box by obs_r_max / food_r, so those must bound the stored radii.
+  SpatialGrid obstacle_grid;
+
+  //does a circle at 'center' with radius 'r' overlap an obstacle? (broadphase via obstacle_grid)
+  bool obstacles_collide(glm::vec2 const &center, float r);
+
+  // per-update scratch lists (kept here so they don't reallocate every frame)
+  std::vector<uint32_t> obstacle_nearby;
+  std::vector<uint32_t> obstacle_moved; // (in increasing order; also read by SnakeMode::draw to interpolate)
+  std::vector<uint32_t> obstacle_arrived;
+
+  //----- snapshots -----
+
+  //copy the whole game into 'into', appending its arrays to 'arena' (sections 'into' already holds are skipped):
+  void save(SnakeSnapshot *into, SnakeSnapshotArena *arena) const;
+  //put the game back the way it was when 'from' was saved into 'arena' (sections that haven't changed since are skipped):
+  void restore(SnakeSnapshot const &from, SnakeSnapshotArena const &arena);
+
+  //the arrays are versioned so save / restore can skip ones that match.
+  // update() bumps versions itself; code that edits the arrays directly should call touch().
+  // (obstacles are split by how often they change, so the per-update timers don't drag the rest along)
+  enum Section : uint32_t {
+    BodySection,
+    ObstacleShapesSection, //radii (fixed once the level is generated)
+    ObstacleMotionSection, //positions and destinations (when some obstacle steps or arrives)
+    ObstacleTimersSection, //movement timers (every update)
+    ObstacleGridSection,
+    FoodsSection,
+    SectionCount
+  };
+  void touch(Section section);
+  uint64_t versions[SectionCount];
+};
+
+//storage for the array sections of any number of snapshots.
+// sections are only ever appended, so a snapshot (or a copy of one) stays valid until clear(),
+//  and snapshots saved one after another from the same game share the sections that didn't change.
+struct SnakeSnapshotArena {
+  std::vector< uint8_t > bytes;
+  uint64_t generation = 1; //bumped by clear(), so snapshots saved before it are noticed
+
+  //drop every section (invalidating the snapshots that point into them), keeping the storage:
+  void clear() {
+    bytes.clear();
+    generation += 1;
+  }
+};
+
+//a saved game: the SnakeState plus where each array section sits in a SnakeSnapshotArena.
+// plain data with no storage of its own, so cloning one is a memcpy.
+struct SnakeSnapshot {
+  SnakeState state;
+  uint64_t generation = 0; //arena generation the sections were saved in
+  uint64_t versions[SnakeSim::SectionCount] = { 0 }; //0 => section not saved yet
+  uint64_t offsets[SnakeSim::SectionCount] = { 0 }; //section bytes are arena.bytes[offset, offset + size)
+  uint64_t sizes[SnakeSim::SectionCount] = { 0 };
+};
+static_assert(std::is_trivially_copyable< SnakeSnapshot >::value, "SnakeSnapshot should be plain data (bots clone it wholesale)");
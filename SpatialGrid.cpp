@@ -0,0 +1,89 @@
+#include "SpatialGrid.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+const uint32_t SpatialGrid::None;
+
+SpatialGrid::SpatialGrid(glm::vec2 const &min, glm::vec2 const &max, float cell_size) {
+	assert(cell_size > 0.0f);
+	origin = min;
+	inv_cell_size = 1.0f / cell_size;
+	size.x = std::max(1, int32_t(std::ceil((max.x - min.x) * inv_cell_size)));
+	size.y = std::max(1, int32_t(std::ceil((max.y - min.y) * inv_cell_size)));
+	heads.assign(size.x * size.y, None);
+}
+
+glm::ivec2 SpatialGrid::coords_of(glm::vec2 const &pos) const {
+	//NOTE: clamp in float first so far-away points can't overflow the int conversion:
+	float x = std::floor((pos.x - origin.x) * inv_cell_size);
+	float y = std::floor((pos.y - origin.y) * inv_cell_size);
+	x = std::min(std::max(x, 0.0f), float(size.x - 1));
+	y = std::min(std::max(y, 0.0f), float(size.y - 1));
+	return glm::ivec2(int32_t(x), int32_t(y));
+}
+
+uint32_t SpatialGrid::cell_of(glm::vec2 const &pos) const {
+	glm::ivec2 c = coords_of(pos);
+	return uint32_t(c.y * size.x + c.x);
+}
+
+void SpatialGrid::reserve(uint32_t count) {
+	if (count <= cells.size()) return;
+	next.resize(count, None);
+	prev.resize(count, None);
+	cells.resize(count, None);
+}
+
+void SpatialGrid::insert(uint32_t id, glm::vec2 const &pos) {
+	if (id >= cells.size()) reserve(id + 1);
+	assert(cells[id] == None && "id already in grid");
+
+	uint32_t cell = cell_of(pos);
+	cells[id] = cell;
+	prev[id] = None;
+	next[id] = heads[cell];
+	if (heads[cell] != None) prev[heads[cell]] = id;
+	heads[cell] = id;
+}
+
+void SpatialGrid::erase(uint32_t id) {
+	if (id >= cells.size() || cells[id] == None) return;
+
+	if (prev[id] != None) next[prev[id]] = next[id];
+	else heads[cells[id]] = next[id];
+	if (next[id] != None) prev[next[id]] = prev[id];
+
+	cells[id] = next[id] = prev[id] = None;
+}
+
+bool SpatialGrid::move(uint32_t id, glm::vec2 const &pos) {
+	assert(id < cells.size() && cells[id] != None);
+	if (cell_of(pos) == cells[id]) return false;
+	erase(id);
+	insert(id, pos);
+	return true;
+}
+
+void SpatialGrid::relabel(uint32_t from, uint32_t to) {
+	assert(from < cells.size() && cells[from] != None);
+	if (to >= cells.size()) reserve(to + 1);
+	assert(cells[to] == None && "id already in grid");
+
+	cells[to] = cells[from];
+	next[to] = next[from];
+	prev[to] = prev[from];
+	if (prev[to] != None) next[prev[to]] = to;
+	else heads[cells[to]] = to;
+	if (next[to] != None) prev[next[to]] = to;
+
+	cells[from] = next[from] = prev[from] = None;
+}
+
+void SpatialGrid::clear() {
+	std::fill(heads.begin(), heads.end(), None);
+	std::fill(next.begin(), next.end(), None);
+	std::fill(prev.begin(), prev.end(), None);
+	std::fill(cells.begin(), cells.end(), None);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/*
+ * SpatialGrid is a uniform grid over a rectangle that buckets small integer ids by position.
+ * Each id lives in the one cell that contains its point; lookups visit the cells overlapping
+ *  a query box, so callers should grow the box by the largest radius stored in the grid.
+ *
+ * Cells are intrusive doubly-linked lists threaded through per-id arrays, so insert, erase,
+ *  move and relabel are O(1) and nothing is allocated once the id arrays have grown.
+ * Points outside the rectangle are clamped into the border cells.
+ */
+
+struct SpatialGrid {
+	SpatialGrid() = default;
+	SpatialGrid(glm::vec2 const &min, glm::vec2 const &max, float cell_size);
+
+	static const uint32_t None = -1U;
+
+	//index of the cell containing 'pos':
+	uint32_t cell_of(glm::vec2 const &pos) const;
+
+	//size the per-id arrays for ids below 'count', so later inserts don't allocate:
+	void reserve(uint32_t count);
+
+	//add 'id' at 'pos' (id must not already be present):
+	void insert(uint32_t id, glm::vec2 const &pos);
+	//remove 'id' (no-op if not present):
+	void erase(uint32_t id);
+	//update the position of 'id'; only touches the lists if its cell changed (and then returns true):
+	bool move(uint32_t id, glm::vec2 const &pos);
+	//give the entry for 'from' the id 'to' (e.g., after a swap-remove; 'to' must not be present):
+	void relabel(uint32_t from, uint32_t to);
+	//remove every id:
+	void clear();
+
+	//call fn(id) for every id in a cell overlapping the box [min,max], stopping early once fn returns true.
+	// returns true if fn did:
+	template< typename F >
+	bool any(glm::vec2 const &min, glm::vec2 const &max, F const &fn) const;
+
+	//call fn(id) for every id in a cell overlapping the box [min,max]:
+	template< typename F >
+	void for_each(glm::vec2 const &min, glm::vec2 const &max, F const &fn) const {
+		any(min, max, [&fn](uint32_t id) { fn(id); return false; });
+	}
+
+	//----- layout -----
+	glm::vec2 origin = glm::vec2(0.0f);
+	float inv_cell_size = 1.0f;
+	glm::ivec2 size = glm::ivec2(0);
+
+	//----- storage -----
+	std::vector< uint32_t > heads; //first id in each cell, or None
+	std::vector< uint32_t > next; //per id: next id in the same cell, or None
+	std::vector< uint32_t > prev; //per id: previous id in the same cell, or None
+	std::vector< uint32_t > cells; //per id: cell index, or None if not present
+
+private:
+	glm::ivec2 coords_of(glm::vec2 const &pos) const;
+};
+
+template< typename F >
+bool SpatialGrid::any(glm::vec2 const &min, glm::vec2 const &max, F const &fn) const {
+	glm::ivec2 lo = coords_of(min);
+	glm::ivec2 hi = coords_of(max);
+	for (int32_t y = lo.y; y <= hi.y; ++y) {
+		for (int32_t x = lo.x; x <= hi.x; ++x) {
+			for (uint32_t id = heads[y * size.x + x]; id != None; id = next[id]) {
+				if (fn(id)) return true;
+			}
+		}
+	}
+	return false;
+}
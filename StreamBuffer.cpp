@@ -0,0 +1,86 @@
+#include "StreamBuffer.hpp"
+
+#include "gl_errors.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <cassert>
+
+StreamBuffer::StreamBuffer(GLsizeiptr region_size_, GLsizeiptr align_, uint32_t regions) : align(align_), fences(regions, nullptr) {
+	assert(align > 0 && regions > 0);
+	region_size = std::max< GLsizeiptr >(1, (region_size_ + align - 1) / align) * align;
+	region = regions - 1; //(so the first map() uses region 0)
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, region_size * regions, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+}
+
+StreamBuffer::~StreamBuffer() {
+	for (GLsync &f : fences) {
+		if (f) glDeleteSync(f);
+		f = nullptr;
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void *StreamBuffer::map(GLsizeiptr size) {
+	size = std::max(size, align); //(mapping zero bytes is an error)
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	if (size > region_size) {
+		//grow: allocating new storage orphans the old (the driver keeps it until pending draws finish),
+		// so the old fences no longer matter:
+		region_size = std::max(size, 2 * region_size);
+		region_size = (region_size + align - 1) / align * align;
+		for (GLsync &f : fences) {
+			if (f) glDeleteSync(f);
+			f = nullptr;
+		}
+		glBufferData(GL_ARRAY_BUFFER, region_size * fences.size(), nullptr, GL_STREAM_DRAW);
+		region = uint32_t(fences.size()) - 1;
+	}
+
+	region = (region + 1) % fences.size();
+	if (fences[region]) {
+		//wait for the GPU to finish reading this region (with triple buffering, it usually already has):
+		GLenum result;
+		do {
+			result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); //(1s)
+		} while (result == GL_TIMEOUT_EXPIRED);
+		if (result == GL_WAIT_FAILED) {
+			std::cerr << "WARNING: waiting on a stream buffer fence failed." << std::endl;
+		}
+		glDeleteSync(fences[region]);
+		fences[region] = nullptr;
+	}
+
+	offset = GLintptr(region) * region_size;
+	void *ptr = glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+		GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (!ptr) {
+		throw std::runtime_error("Failed to map stream buffer.");
+	}
+	return ptr;
+}
+
+bool StreamBuffer::unmap(GLsizeiptr used) {
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	if (used > 0) glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, used); //(relative to the mapping)
+	GLboolean ok = glUnmapBuffer(GL_ARRAY_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return ok == GL_TRUE;
+}
+
+void StreamBuffer::fence() {
+	assert(!fences[region] && "region fenced twice");
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
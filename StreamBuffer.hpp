@@ -0,0 +1,49 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <vector>
+#include <cstdint>
+
+/*
+ * StreamBuffer is a vertex buffer for data that is rewritten every frame.
+ * One buffer object is split into 'regions' equal regions (3 => triple buffering); each frame
+ *  maps the next region with glMapBufferRange (unsynchronized, so the driver doesn't stall or
+ *  copy) and the caller writes vertices straight into it.
+ * A fence after each frame's draws keeps a region from being rewritten while the GPU may still read it.
+ *
+ * Usage, once per frame:
+ *   Vertex *out = (Vertex *)stream.map(max_bytes);
+ *   ... write up to max_bytes at out ...
+ *   stream.unmap(bytes_written);
+ *   ... draw from stream.buffer, starting at stream.offset ...
+ *   stream.fence();
+ *
+ * (OpenGL 3.3 has no persistent mappings, so each frame maps and unmaps; that costs a driver call,
+ *  but no copies or reallocations.)
+ */
+
+struct StreamBuffer {
+	//regions start at 'region_size' bytes and grow (by reallocating) if a frame needs more;
+	// region sizes are kept a multiple of 'align', so 'offset' is too:
+	StreamBuffer(GLsizeiptr region_size, GLsizeiptr align, uint32_t regions = 3);
+	~StreamBuffer();
+	StreamBuffer(StreamBuffer const &) = delete;
+	StreamBuffer &operator=(StreamBuffer const &) = delete;
+
+	//wait until the next region is free and map 'size' bytes of it for writing (throws on failure):
+	void *map(GLsizeiptr size);
+	//done writing; the first 'used' bytes of the mapping hold data.
+	// returns false if the mapping's contents were lost (rare; skip drawing this frame):
+	bool unmap(GLsizeiptr used);
+	//call after issuing the draws that read this frame's data:
+	void fence();
+
+	GLuint buffer = 0;
+	GLintptr offset = 0; //start of the current mapping in 'buffer'
+
+	GLsizeiptr region_size = 0;
+	GLsizeiptr align = 1;
+	uint32_t region = 0; //region currently (or most recently) mapped
+	std::vector< GLsync > fences; //per region: signalled once the GPU is done with it (or 0)
+};
@@ -0,0 +1,242 @@
+#include "TextureLoader.hpp"
+
+#include "gl_errors.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+#include <stdexcept>
+
+//---- file mapping ----
+
+struct TextureLoader::MappedFile {
+	//NOTE: throws on error
+	MappedFile(std::string const &filename);
+	~MappedFile();
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+
+	uint8_t const *data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#endif
+};
+
+#ifdef _WIN32
+
+TextureLoader::MappedFile::MappedFile(std::string const &filename) {
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	LARGE_INTEGER file_size;
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &file_size)) {
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		throw std::runtime_error("Failed to open image file '" + filename + "'.");
+	}
+	size = size_t(file_size.QuadPart);
+	if (size == 0) return; //(can't map an empty file; the PNG check will catch it)
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping) data = reinterpret_cast< uint8_t const * >(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!data) {
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("Failed to map image file '" + filename + "'.");
+	}
+}
+
+TextureLoader::MappedFile::~MappedFile() {
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+}
+
+#else
+
+TextureLoader::MappedFile::MappedFile(std::string const &filename) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		if (fd >= 0) close(fd);
+		throw std::runtime_error("Failed to open image file '" + filename + "'.");
+	}
+	size = size_t(st.st_size);
+	if (size == 0) { //(can't map an empty file; the PNG check will catch it)
+		close(fd);
+		return;
+	}
+	void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); //(the mapping keeps the file open)
+	if (mapped == MAP_FAILED) {
+		throw std::runtime_error("Failed to map image file '" + filename + "'.");
+	}
+	madvise(mapped, size, MADV_SEQUENTIAL);
+	data = reinterpret_cast< uint8_t const * >(mapped);
+}
+
+TextureLoader::MappedFile::~MappedFile() {
+	if (data) munmap(const_cast< uint8_t * >(data), size);
+}
+
+#endif
+
+//---- loader ----
+
+TextureLoader::TextureLoader() {
+	glGenFramebuffers(1, &clear_framebuffer);
+	worker = std::thread(&TextureLoader::decode_loads, this);
+}
+
+TextureLoader::~TextureLoader() {
+	//wait for the worker to finish its current load (so no buffer is still being written), then release everything:
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	cv.notify_all();
+	worker.join();
+
+	while (!loads.empty()) {
+		try {
+			poll();
+		} catch (std::exception const &e) {
+			std::cerr << "WARNING: " << e.what() << std::endl;
+		}
+	}
+
+	glDeleteFramebuffers(1, &clear_framebuffer);
+	clear_framebuffer = 0;
+}
+
+GLuint TextureLoader::load(std::string const &filename, OriginLocation origin) {
+	std::shared_ptr< Load > load = std::make_shared< Load >();
+	load->filename = filename;
+	load->origin = origin;
+	load->file.reset(new MappedFile(filename));
+	if (!png_size(load->file->data, load->file->size, &load->size)) {
+		throw std::runtime_error("Image file '" + filename + "' is not a PNG.");
+	}
+
+	//texture storage now (so the name can be used right away); pixels arrive in poll():
+	glGenTextures(1, &load->texture);
+	glBindTexture(GL_TEXTURE_2D, load->texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, load->size.x, load->size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	//...which starts out undefined, so clear it on the GPU (glClearBuffer leaves the clear color alone; nothing here uses scissoring or color masks):
+	if (load->size.x && load->size.y) {
+		GLint old_framebuffer = 0;
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &old_framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, clear_framebuffer);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, load->texture, 0);
+		static const GLfloat transparent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		glClearBufferfv(GL_COLOR, 0, transparent);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GLuint(old_framebuffer));
+	}
+
+	//...and a buffer for the worker to decode into (stays mapped until poll() sees it's done):
+	size_t bytes = size_t(load->size.x) * load->size.y * sizeof(glm::u8vec4);
+	glGenBuffers(1, &load->buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, load->buffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+	if (bytes) {
+		load->pixels = reinterpret_cast< glm::u8vec4 * >(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	GL_ERRORS();
+	if (!load->pixels) {
+		glDeleteBuffers(1, &load->buffer);
+		glDeleteTextures(1, &load->texture);
+		throw std::runtime_error("Failed to map a pixel buffer for '" + filename + "'.");
+	}
+
+	loads.emplace_back(load);
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		todo.emplace_back(load);
+	}
+	cv.notify_all();
+
+	return load->texture;
+}
+
+void TextureLoader::poll() {
+	while (!loads.empty()) {
+		std::shared_ptr< Load > load = loads.front();
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			if (!load->decoded && !quit) break; //(one worker, so later loads aren't done either)
+		}
+		loads.pop_front();
+		load->file.reset(); //(done reading it)
+		bool abandoned = !load->decoded; //(loader is being destroyed)
+
+		//unmapping hands the pixels to GL; the upload reads from the buffer, so it needn't finish before this returns:
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, load->buffer);
+		bool intact = (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE);
+		load->pixels = nullptr;
+		if (load->ok && intact) {
+			glBindTexture(GL_TEXTURE_2D, load->texture);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, load->size.x, load->size.y, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid *)0);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glDeleteBuffers(1, &load->buffer); //(GL keeps it around until the upload is done)
+		load->buffer = 0;
+		GL_ERRORS();
+
+		if (abandoned) continue;
+		if (!load->ok) {
+			throw std::runtime_error("Failed to decode PNG image from '" + load->filename + "'.");
+		}
+		if (!intact) {
+			throw std::runtime_error("Lost the pixel buffer for '" + load->filename + "' (display mode change?).");
+		}
+	}
+}
+
+void TextureLoader::finish() {
+	while (!loads.empty()) {
+		{
+			std::shared_ptr< Load > const &last = loads.back();
+			std::unique_lock< std::mutex > lock(mutex);
+			cv.wait(lock, [&last](){ return last->decoded; });
+		}
+		poll();
+	}
+}
+
+void TextureLoader::decode_loads() {
+	while (true) {
+		std::shared_ptr< Load > load;
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			cv.wait(lock, [this](){ return quit || !todo.empty(); });
+			if (quit) return; //(anything left in todo is released, undecoded, by the destructor)
+			load = todo.front();
+			todo.pop_front();
+		}
+
+		bool ok = load_png(load->file->data, load->file->size, load->size, load->pixels, load->origin);
+
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			load->ok = ok;
+			load->decoded = true;
+		}
+		cv.notify_all();
+	}
+}
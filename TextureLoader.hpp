@@ -0,0 +1,73 @@
+#pragma once
+
+#include "GL.hpp"
+#include "load_save_png.hpp"
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*
+ * TextureLoader loads PNG files into textures in the background:
+ *  load() maps the file into memory, reads its size from the header, allocates the texture,
+ *  and maps a GL_PIXEL_UNPACK_BUFFER for the pixels; a worker thread then decodes rows
+ *  from the file mapping straight into that buffer (no intermediate copies);
+ *  poll() (once per frame) unmaps finished buffers and starts glTexSubImage2D from them.
+ *
+ * Textures are usable (cleared to transparent black) as soon as load() returns, so art can stream in
+ *  over the first few frames instead of holding up startup.
+ *
+ * Create and destroy with the GL context current; the destructor uploads loads that have been decoded
+ *  and drops the rest (their textures stay allocated, but empty).
+ */
+
+struct TextureLoader {
+	TextureLoader();
+	~TextureLoader();
+	TextureLoader(TextureLoader const &) = delete;
+	TextureLoader &operator=(TextureLoader const &) = delete;
+
+	//start loading 'filename' into a new GL_TEXTURE_2D (RGBA8, linear filtering, clamped) and return its name.
+	// NOTE: throws if the file can't be opened or isn't a PNG
+	GLuint load(std::string const &filename, OriginLocation origin = LowerLeftOrigin);
+
+	//upload every load the worker has finished decoding:
+	// NOTE: throws if one failed to decode (its texture is left as-is); call again for the rest
+	void poll();
+
+	//wait for every pending load to be decoded and uploaded:
+	void finish();
+
+	uint32_t pending() const { return uint32_t(loads.size()); }
+
+	//framebuffer used to clear new textures (glTexImage2D with no data leaves them undefined):
+	GLuint clear_framebuffer = 0;
+
+	//----- shared with worker thread -----
+	struct MappedFile; //(a read-only memory mapping of a file)
+	struct Load {
+		std::string filename;
+		OriginLocation origin = LowerLeftOrigin;
+		std::unique_ptr< MappedFile > file;
+		glm::uvec2 size = glm::uvec2(0);
+		GLuint texture = 0;
+		GLuint buffer = 0; //GL_PIXEL_UNPACK_BUFFER, mapped while decoding
+		glm::u8vec4 *pixels = nullptr; //the mapping
+		bool decoded = false; //(set by worker)
+		bool ok = false; //(set by worker)
+	};
+	std::deque< std::shared_ptr< Load > > loads; //(main thread) oldest first
+	std::deque< std::shared_ptr< Load > > todo; //for worker
+	bool quit = false;
+	std::mutex mutex;
+	std::condition_variable cv; //todo has work (or quit) / a load was decoded
+
+	//----- worker thread -----
+	std::thread worker;
+	void decode_loads();
+};
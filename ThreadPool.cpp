@@ -0,0 +1,122 @@
+#include "ThreadPool.hpp"
+
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+//which pool (and which worker in it) the current thread is, if any:
+static thread_local ThreadPool const *current_pool = nullptr;
+static thread_local uint32_t current_index = 0;
+
+ThreadPool::ThreadPool(uint32_t threads) : queued(0), pending(0), next_worker(0) {
+	if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+	workers.reserve(threads);
+	for (uint32_t i = 0; i < threads; ++i) {
+		workers.emplace_back(new Worker);
+	}
+	//(start threads only once every deque exists, since workers steal from each other)
+	for (uint32_t i = 0; i < threads; ++i) {
+		workers[i]->thread = std::thread(&ThreadPool::run, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	try {
+		wait();
+	} catch (...) {
+		//nowhere to report it from a destructor
+	}
+	{
+		std::lock_guard< std::mutex > lock(sleep_mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto &worker : workers) {
+		worker->thread.join();
+	}
+}
+
+void ThreadPool::submit(Task task) {
+	uint32_t index;
+	if (current_pool == this) {
+		index = current_index;
+	} else {
+		index = next_worker.fetch_add(1) % size();
+	}
+
+	pending.fetch_add(1);
+	{
+		Worker &worker = *workers[index];
+		std::lock_guard< std::mutex > lock(worker.mutex);
+		worker.tasks.emplace_back(std::move(task));
+	}
+	{
+		//(taking the lock keeps a worker from missing this between checking 'queued' and sleeping)
+		std::lock_guard< std::mutex > lock(sleep_mutex);
+		queued.fetch_add(1);
+	}
+	wake.notify_one();
+}
+
+void ThreadPool::wait() {
+	assert(current_pool != this && "ThreadPool::wait() called from one of its own tasks would never return");
+	std::unique_lock< std::mutex > lock(done_mutex);
+	done.wait(lock, [this](){ return pending.load() == 0; });
+	if (error) {
+		std::exception_ptr e = error;
+		error = nullptr;
+		std::rethrow_exception(e);
+	}
+}
+
+bool ThreadPool::pop(uint32_t index, Task *task) {
+	Worker &worker = *workers[index];
+	std::lock_guard< std::mutex > lock(worker.mutex);
+	if (worker.tasks.empty()) return false;
+	*task = std::move(worker.tasks.back());
+	worker.tasks.pop_back();
+	queued.fetch_sub(1);
+	return true;
+}
+
+bool ThreadPool::steal(uint32_t index, Task *task) {
+	for (uint32_t offset = 1; offset < size(); ++offset) {
+		Worker &victim = *workers[(index + offset) % size()];
+		std::lock_guard< std::mutex > lock(victim.mutex);
+		if (victim.tasks.empty()) continue;
+		*task = std::move(victim.tasks.front());
+		victim.tasks.pop_front();
+		queued.fetch_sub(1);
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::run(uint32_t index) {
+	current_pool = this;
+	current_index = index;
+	trace::set_thread_name("worker " + std::to_string(index));
+
+	Task task;
+	while (true) {
+		if (pop(index, &task) || steal(index, &task)) {
+			try {
+				task();
+			} catch (...) {
+				std::lock_guard< std::mutex > lock(done_mutex);
+				if (!error) error = std::current_exception();
+			}
+			task = nullptr;
+			if (pending.fetch_sub(1) == 1) {
+				std::lock_guard< std::mutex > lock(done_mutex);
+				done.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock< std::mutex > lock(sleep_mutex);
+		wake.wait(lock, [this](){ return stopping || queued.load() > 0; });
+		if (stopping && queued.load() == 0) return;
+	}
+}
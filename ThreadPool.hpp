@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <exception>
+#include <cstdint>
+
+/*
+ * ThreadPool runs tasks on a fixed set of worker threads with work stealing:
+ *  each worker has its own deque, takes its newest task first, and when it runs dry
+ *  steals the oldest task from another worker. Tasks submitted from inside a task go on
+ *  the submitting worker's deque, so recursively splitting a big job keeps every core busy.
+ */
+
+struct ThreadPool {
+	typedef std::function< void() > Task;
+
+	//threads == 0 means one per hardware thread:
+	ThreadPool(uint32_t threads = 0);
+	~ThreadPool(); //finishes queued tasks, then joins the workers
+
+	uint32_t size() const { return uint32_t(workers.size()); }
+
+	//queue 'task' to run on some worker:
+	void submit(Task task);
+
+	//block until every submitted task (including tasks submitted by tasks) has finished.
+	// rethrows the first exception a task threw, if any.
+	// NOTE: call from outside the pool only -- from inside a task it would wait for itself (asserts in debug builds);
+	//  a task that needs results from tasks it submits should run that work itself, or split it as in Rollouts.cpp.
+	void wait();
+
+private:
+	struct Worker {
+		std::mutex mutex;
+		std::deque< Task > tasks;
+		std::thread thread;
+	};
+	std::vector< std::unique_ptr< Worker > > workers;
+
+	void run(uint32_t index);
+	bool pop(uint32_t index, Task *task); //newest task from own deque
+	bool steal(uint32_t index, Task *task); //oldest task from another worker's deque
+
+	std::atomic< int32_t > queued; //tasks sitting in deques (may briefly dip below zero while a submit is in flight)
+	std::atomic< uint64_t > pending; //tasks submitted but not yet finished
+	std::atomic< uint32_t > next_worker; //round-robin target for submits from outside the pool
+	bool stopping = false;
+
+	std::mutex sleep_mutex;
+	std::condition_variable wake; //signalled when a task is queued (or on shutdown)
+
+	std::mutex done_mutex;
+	std::condition_variable done; //signalled when 'pending' drops to zero
+	std::exception_ptr error;
+};
@@ -0,0 +1,138 @@
+#include "Trace.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define TRACE_RDTSC
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#else
+		#include <x86intrin.h>
+	#endif
+#endif
+
+namespace trace {
+
+std::atomic< bool > enabled(false);
+std::atomic< bool > detail(false);
+thread_local uint32_t detail_depth = 0;
+
+namespace {
+	struct Event {
+		char const *name;
+		uint64_t begin, end;
+	};
+
+	//per-thread storage; owned by 'buffers' so zones outlive the threads that recorded them:
+	struct Buffer {
+		uint32_t tid = 0;
+		std::string name;
+		std::vector< Event > events;
+		uint64_t dropped = 0;
+	};
+
+	//cap each thread's buffer (~24MB) so a forgotten trace can't eat all memory:
+	const size_t MaxEvents = 1 << 20;
+
+	std::mutex buffers_mutex;
+	std::vector< std::shared_ptr< Buffer > > buffers;
+
+	//a reference point for converting ticks to time:
+	struct Epoch {
+		Epoch() : ticks(now()), clock(std::chrono::steady_clock::now()) { }
+		uint64_t ticks;
+		std::chrono::steady_clock::time_point clock;
+	};
+	Epoch const &epoch() {
+		static Epoch e;
+		return e;
+	}
+
+	Buffer &this_thread_buffer() {
+		thread_local Buffer *buffer = nullptr;
+		if (!buffer) {
+			std::lock_guard< std::mutex > lock(buffers_mutex);
+			buffers.emplace_back(std::make_shared< Buffer >());
+			buffer = buffers.back().get();
+			buffer->tid = uint32_t(buffers.size());
+			buffer->name = "thread " + std::to_string(buffer->tid);
+			buffer->events.reserve(4096);
+			epoch(); //(times are written relative to the first thread's first zone)
+		}
+		return *buffer;
+	}
+
+}
+
+uint64_t now() {
+#ifdef TRACE_RDTSC
+	return __rdtsc();
+#else
+	return uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+void record(char const *name, uint64_t begin, uint64_t end) {
+	Buffer &buffer = this_thread_buffer();
+	if (buffer.events.size() >= MaxEvents) {
+		buffer.dropped += 1;
+		return;
+	}
+	buffer.events.push_back(Event{name, begin, end});
+}
+
+void set_thread_name(std::string const &name) {
+	this_thread_buffer().name = name;
+}
+
+void dump(std::string const &filename) {
+	//microseconds per tick, measured over the run so far (rdtsc rates vary by machine):
+	Epoch const &start = epoch();
+	Epoch end;
+	double us_per_tick = 1.0e-3;
+#ifdef TRACE_RDTSC
+	double elapsed_us = std::chrono::duration< double, std::micro >(end.clock - start.clock).count();
+	if (end.ticks > start.ticks && elapsed_us > 0.0) {
+		us_per_tick = elapsed_us / double(end.ticks - start.ticks);
+	}
+#endif
+
+	std::ofstream file(filename.c_str());
+	if (!file) {
+		throw std::runtime_error("Failed to open trace file '" + filename + "' for writing.");
+	}
+
+	file.setf(std::ios::fixed);
+	file.precision(3); //(nanoseconds)
+
+	std::lock_guard< std::mutex > lock(buffers_mutex);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	for (auto const &buffer : buffers) {
+		file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+			<< ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+		first = false;
+		if (buffer->dropped) {
+			file << ",\n{\"name\":\"dropped " << buffer->dropped << " zones\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" << buffer->tid
+				<< ",\"ts\":0}";
+		}
+		for (Event const &e : buffer->events) {
+			//(zones from before the epoch was taken get clamped to it)
+			double ts = e.begin > start.ticks ? double(e.begin - start.ticks) * us_per_tick : 0.0;
+			double dur = double(e.end - e.begin) * us_per_tick;
+			file << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+				<< ",\"ts\":" << ts << ",\"dur\":" << dur << "}";
+		}
+	}
+	file << "\n]}\n";
+	if (!file) {
+		throw std::runtime_error("Failed to write trace to '" + filename + "'.");
+	}
+}
+
+} //namespace trace
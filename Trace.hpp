@@ -0,0 +1,85 @@
+#pragma once
+
+/*
+ * Trace records scoped zones (name + begin/end time, per thread) and writes them out as
+ *  Chrome trace-event JSON, for viewing in chrome://tracing or ui.perfetto.dev.
+ *
+ * Mark a zone with TRACE_ZONE("name") at the top of a scope; 'name' must be a string literal
+ *  (only the pointer is stored). Each thread appends to its own buffer, timestamped with
+ *  rdtsc on x86-64 (steady_clock elsewhere), so a zone costs a few tens of nanoseconds.
+ *
+ * Zones in hot code (e.g., each pass of SnakeSim::update, which takes a few hundred nanoseconds)
+ *  use TRACE_DETAIL_ZONE instead, and are only recorded when trace::detail is also set: at that
+ *  grain the zones cost about as much as the work they time. Likewise, ordinary zones inside a
+ *  TRACE_DETAIL_SCOPE() (e.g., a rollout's millions of updates) count as detail zones on that thread.
+ *
+ * Zones only exist in builds with BSNAKE_TRACE defined (e.g., add -DBSNAKE_TRACE to C++FLAGS);
+ *  otherwise the macros expand to nothing. Even when compiled in, nothing is recorded until
+ *  trace::enabled is set.
+ */
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+namespace trace {
+
+//record zones? (off by default):
+extern std::atomic< bool > enabled;
+
+//also record detail zones? (off by default):
+extern std::atomic< bool > detail;
+
+//TRACE_DETAIL_SCOPE()s the calling thread is inside:
+extern thread_local uint32_t detail_depth;
+
+inline bool recording(bool detail_zone) {
+	if (!enabled.load(std::memory_order_relaxed)) return false;
+	if (detail_zone || detail_depth) return detail.load(std::memory_order_relaxed);
+	return true;
+}
+
+//timestamp in ticks (rdtsc or steady_clock nanoseconds; converted when written out):
+uint64_t now();
+
+//store a finished zone in this thread's buffer:
+void record(char const *name, uint64_t begin, uint64_t end);
+
+//label the calling thread in the trace (e.g., "main"); 'name' is copied:
+void set_thread_name(std::string const &name);
+
+//write every thread's zones so far to 'filename' (keeps recording afterward).
+// call while other threads aren't recording (e.g., from the main loop, or after ThreadPool::wait).
+// NOTE: throws on error
+void dump(std::string const &filename);
+
+struct Zone {
+	Zone(char const *name_, bool detail_zone = false) : name(name_), begin(recording(detail_zone) ? now() : 0) { }
+	~Zone() { if (begin) record(name, begin, now()); }
+	Zone(Zone const &) = delete;
+	Zone &operator=(Zone const &) = delete;
+	char const *name;
+	uint64_t begin; //0 => not recording
+};
+
+struct DetailScope {
+	DetailScope() { ++detail_depth; }
+	~DetailScope() { --detail_depth; }
+	DetailScope(DetailScope const &) = delete;
+	DetailScope &operator=(DetailScope const &) = delete;
+};
+
+} //namespace trace
+
+#define TRACE_CONCAT2(A, B) A ## B
+#define TRACE_CONCAT(A, B) TRACE_CONCAT2(A, B)
+
+#ifdef BSNAKE_TRACE
+#define TRACE_ZONE( NAME ) trace::Zone TRACE_CONCAT(trace_zone_, __LINE__)(NAME)
+#define TRACE_DETAIL_ZONE( NAME ) trace::Zone TRACE_CONCAT(trace_zone_, __LINE__)(NAME, true)
+#define TRACE_DETAIL_SCOPE() trace::DetailScope TRACE_CONCAT(trace_detail_scope_, __LINE__)
+#else
+#define TRACE_ZONE( NAME )
+#define TRACE_DETAIL_ZONE( NAME )
+#define TRACE_DETAIL_SCOPE()
+#endif
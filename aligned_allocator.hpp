@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+/*
+ * AlignedAllocator hands out storage aligned to 'Align' bytes,
+ *  e.g. so std::vector< float, AlignedAllocator< float > > can be read with aligned SIMD loads.
+ */
+
+template< typename T, size_t Align = 32 >
+struct AlignedAllocator {
+	typedef T value_type;
+	template< typename U > struct rebind { typedef AlignedAllocator< U, Align > other; };
+
+	AlignedAllocator() { }
+	template< typename U > AlignedAllocator(AlignedAllocator< U, Align > const &) { }
+
+	T *allocate(size_t count) {
+		void *ret = nullptr;
+		#ifdef _WIN32
+		ret = _aligned_malloc(count * sizeof(T), Align);
+		#else
+		if (posix_memalign(&ret, Align, count * sizeof(T)) != 0) ret = nullptr;
+		#endif
+		if (!ret) throw std::bad_alloc();
+		return static_cast< T * >(ret);
+	}
+	void deallocate(T *ptr, size_t) {
+		#ifdef _WIN32
+		_aligned_free(ptr);
+		#else
+		free(ptr);
+		#endif
+	}
+};
+
+template< typename T, typename U, size_t Align >
+bool operator==(AlignedAllocator< T, Align > const &, AlignedAllocator< U, Align > const &) { return true; }
+template< typename T, typename U, size_t Align >
+bool operator!=(AlignedAllocator< T, Align > const &, AlignedAllocator< U, Align > const &) { return false; }
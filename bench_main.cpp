@@ -0,0 +1,198 @@
+//bsnake-bench times the simulation and the CPU side of drawing, and prints one CSV line per benchmark:
+#include "Bench.hpp"
+#include "SnakeSim.hpp"
+#include "CircleView.hpp"
+#include "load_save_png.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//results are added in here so the optimizer can't drop the work that made them:
+static volatile uint64_t sink = 0;
+
+//settings for a level with 'count' obstacles (the arena grows to keep the usual obstacle density):
+static SnakeState level_settings(uint32_t count) {
+	SnakeState settings;
+	settings.arena_radius *= std::sqrt(count / float(settings.obs_count_init));
+	settings.obs_count_init = count;
+	return settings;
+}
+
+int main(int argc, char **argv) {
+	uint32_t seed = 1;
+	float min_seconds = 0.5f;
+	std::string filter;
+	std::string png_path = "bsnake-bench.png";
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--seed" && i + 1 < argc) {
+			seed = static_cast< uint32_t >(std::stoul(argv[++i]));
+		} else if (arg == "--min-time" && i + 1 < argc) {
+			min_seconds = std::stof(argv[++i]);
+		} else if (arg == "--filter" && i + 1 < argc) {
+			filter = argv[++i];
+		} else if (arg == "--png-path" && i + 1 < argc) {
+			png_path = argv[++i];
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--seed <n>] [--min-time <seconds>] [--filter <name part>] [--png-path <scratch file>]" << std::endl;
+			return 1;
+		}
+	}
+
+	Bench bench(std::cout, min_seconds, filter);
+	const float tick = 1.0f / 60.0f;
+
+	//---- SnakeSim::update ----
+	// (steering for the exit; the level restarts from its first frame whenever a game ends, which isn't timed)
+	if (bench.selected("update")) {
+		for (uint32_t count : { 60u, 1000u, 10000u, 100000u }) {
+			SnakeSim sim(seed, level_settings(count));
+			SnakeSnapshotArena arena;
+			SnakeSnapshot start;
+			sim.save(&start, &arena);
+			bench.run("update", count, [&]() {
+				if (sim.over) bench.untimed([&]() { sim.restore(start, arena); });
+				sim.steer(sim.exit_pos - sim.snake_pos);
+				sim.update(tick);
+			});
+		}
+	}
+
+	//---- food lookups ----
+	// (a pool of 'count' foods, at the density of the default pool filling the default arena)
+	if (bench.selected("food")) {
+		for (uint32_t count : { 1000u, 10000u, 100000u }) {
+			SnakeState settings;
+			glm::vec2 radius = settings.arena_radius * std::sqrt(count / float(settings.food_cap));
+			FoodPool foods(count, SpatialGrid(-radius, radius, settings.grid_cell_size));
+
+			SnakeRng rng;
+			rng.seed(seed);
+			SnakeRng::UniformFloat x_dist(-radius.x, radius.x);
+			SnakeRng::UniformFloat y_dist(-radius.y, radius.y);
+			auto random_point = [&]() {
+				float x = x_dist(rng);
+				float y = y_dist(rng);
+				return glm::vec2(x, y);
+			};
+			while (!foods.full()) {
+				foods.add(random_point(), settings.food_r);
+			}
+			std::vector< glm::vec2 > points(1024);
+			for (auto &p : points) {
+				p = random_point();
+			}
+
+			//the snake's mouth check in SnakeSim::update:
+			uint32_t next = 0;
+			bench.run("food_eat_check", count, [&]() {
+				glm::vec2 const &at = points[next++ % points.size()];
+				glm::vec2 reach = glm::vec2(settings.snake_r + settings.food_r);
+				bool hit = foods.grid.any(at - reach, at + reach, [&](uint32_t i) {
+					glm::vec3 const &f = foods[i];
+					return SnakeSim::isCirclesCollide(at, settings.snake_r, glm::vec2(f.x, f.y), f.z);
+				});
+				sink += hit;
+			});
+
+			bench.run("food_oldest", count, [&]() {
+				sink += foods.oldest();
+			});
+
+			//spawning into a full pool (FoodPool::DespawnOldest):
+			bench.run("food_respawn", count, [&]() {
+				foods.remove(foods.oldest());
+				foods.add(points[next++ % points.size()], settings.food_r);
+			});
+		}
+	}
+
+	//---- circles ----
+	if (bench.selected("circle")) {
+		//what SnakeMode::draw does on the CPU each frame: cull against the view, then write one instance per circle
+		// (viewing a 16:9 window with the snake's mouth open, a few seconds into the game):
+		for (uint32_t count : { 60u, 1000u, 10000u, 100000u }) {
+			SnakeSim sim(seed, level_settings(count));
+			sim.snake_mouth_open = false; //(don't eat the food)
+			for (uint32_t step = 0; step < 120 && !sim.over; ++step) {
+				sim.update(tick);
+			}
+			glm::vec2 view_radius = glm::vec2(16.0f / 9.0f, 1.0f) * (5.0f / 2.0f);
+			CircleView view;
+			std::vector< CircleInstance > circles;
+			bench.run("circle_instances", count, [&]() {
+				view.cull(sim, sim.snake_pos - view_radius, sim.snake_pos + view_radius);
+
+				circles.clear();
+				for (uint32_t b = sim.snake_body.size(); b-- > 0; ) {
+					if (view.contains(sim.snake_body[b].pos, sim.snake_r)) {
+						circles.push_back(CircleInstance{ sim.snake_body[b].pos, sim.snake_r, glm::u8vec4(b) });
+					}
+				}
+				for (uint32_t f : view.foods) {
+					glm::vec3 const &food = sim.foods[f];
+					circles.push_back(CircleInstance{ glm::vec2(food.x, food.y), food.z, glm::u8vec4(0xff) });
+				}
+				for (uint32_t o : view.obstacles) {
+					circles.push_back(CircleInstance{ sim.obstacles.pos(o), sim.obstacles.r[o], glm::u8vec4(o % 5) });
+				}
+				sink += circles.size();
+			});
+		}
+	}
+
+	//---- PNG save / load (square images, sized like small and large screenshots) ----
+	if (bench.selected("png")) {
+		for (uint32_t size : { 256u, 1024u }) {
+			//smooth gradients with a sprinkling of noise, so it compresses about like a screenshot:
+			std::vector< glm::u8vec4 > image(size * size);
+			SnakeRng rng;
+			rng.seed(seed);
+			for (uint32_t y = 0; y < size; ++y) {
+				for (uint32_t x = 0; x < size; ++x) {
+					uint8_t noise = (rng() % 16 == 0 ? uint8_t(rng()) : 0);
+					image[y * size + x] = glm::u8vec4(x * 255 / size, y * 255 / size, noise, 0xff);
+				}
+			}
+
+			bench.run("png_save", size, [&]() {
+				save_png(png_path, glm::uvec2(size), image.data(), LowerLeftOrigin);
+			});
+
+			PngSaveOptions fast = PngSaveOptions::fast();
+			bench.run("png_save_fast", size, [&]() {
+				save_png(png_path, glm::uvec2(size), image.data(), LowerLeftOrigin, fast);
+			});
+
+			//striped encoder, one strip per hardware thread (on a one-core machine, the same as the libpng path):
+			PngSaveOptions striped;
+			striped.threads = 0;
+			bench.run("png_save_striped", size, [&]() {
+				save_png(png_path, glm::uvec2(size), image.data(), LowerLeftOrigin, striped);
+			});
+			PngSaveOptions striped_fast = PngSaveOptions::fast();
+			striped_fast.threads = 0;
+			bench.run("png_save_striped_fast", size, [&]() {
+				save_png(png_path, glm::uvec2(size), image.data(), LowerLeftOrigin, striped_fast);
+			});
+
+			save_png(png_path, glm::uvec2(size), image.data(), LowerLeftOrigin);
+			glm::uvec2 loaded_size;
+			std::vector< glm::u8vec4 > loaded;
+			bench.run("png_load", size, [&]() {
+				load_png(png_path, &loaded_size, &loaded, LowerLeftOrigin);
+				sink += loaded.size();
+			});
+		}
+		std::remove(png_path.c_str());
+	}
+
+	return 0;
+}
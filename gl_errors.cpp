@@ -0,0 +1,95 @@
+#include "gl_errors.hpp"
+
+#ifndef NDEBUG
+
+#include <cstring>
+#include <string>
+
+//GL.hpp covers 3.3 core, so the debug-output pieces (KHR_debug, core in 4.3; same values in GL_ARB_debug_output) are here:
+#define GL_DEBUG_OUTPUT                   0x92E0
+#define GL_DEBUG_SOURCE_API               0x8246
+#define GL_DEBUG_SOURCE_WINDOW_SYSTEM     0x8247
+#define GL_DEBUG_SOURCE_SHADER_COMPILER   0x8248
+#define GL_DEBUG_SOURCE_THIRD_PARTY       0x8249
+#define GL_DEBUG_SOURCE_APPLICATION       0x824A
+#define GL_DEBUG_TYPE_ERROR               0x824C
+#define GL_CONTEXT_FLAG_DEBUG_BIT         0x00000002
+
+typedef void (APIENTRY *GLDEBUGPROC)(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, GLchar const *message, void const *user_param);
+typedef void (APIENTRY *PFNGLDEBUGMESSAGECALLBACK)(GLDEBUGPROC callback, void const *user_param);
+typedef void (APIENTRY *PFNGLDEBUGMESSAGECONTROL)(GLenum source, GLenum type, GLenum severity, GLsizei count, GLuint const *ids, GLboolean enabled);
+
+bool gl_debug_output = false;
+std::atomic< char const * > gl_errors_where(nullptr);
+
+static void APIENTRY debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, GLchar const *message, void const *user_param) {
+	if (type != GL_DEBUG_TYPE_ERROR) return; //(only errors are enabled, but ARB_debug_output drivers may be loose about it)
+
+	char const *from = "other";
+	if (source == GL_DEBUG_SOURCE_API) from = "api";
+	else if (source == GL_DEBUG_SOURCE_WINDOW_SYSTEM) from = "window system";
+	else if (source == GL_DEBUG_SOURCE_SHADER_COMPILER) from = "shader compiler";
+	else if (source == GL_DEBUG_SOURCE_THIRD_PARTY) from = "third party";
+	else if (source == GL_DEBUG_SOURCE_APPLICATION) from = "application";
+
+	char const *where = gl_errors_where.load(std::memory_order_relaxed);
+	//(length < 0 => null-terminated)
+	std::string text = (length < 0 ? std::string(message) : std::string(message, length));
+	//(reports are asynchronous, so 'where' is approximate -- the driver's id and message text pin down the call)
+	std::cerr << "WARNING: gl error " << id << " (" << from << ") '" << text << "' near " << (where ? where : "context creation") << std::endl;
+}
+
+bool init_gl_debug_output(void *(*get_proc_address)(char const *)) {
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	bool khr = (major > 4 || (major == 4 && minor >= 3)); //(KHR_debug is core in 4.3)
+	bool arb = false;
+	GLint extensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+	for (GLint i = 0; i < extensions; ++i) {
+		char const *name = reinterpret_cast< char const * >(glGetStringi(GL_EXTENSIONS, i));
+		if (!name) continue;
+		if (std::strcmp(name, "GL_KHR_debug") == 0) khr = true;
+		if (std::strcmp(name, "GL_ARB_debug_output") == 0) arb = true;
+	}
+
+	//(in a core profile, KHR_debug's entry points have no suffix)
+	PFNGLDEBUGMESSAGECALLBACK callback = nullptr;
+	PFNGLDEBUGMESSAGECONTROL control = nullptr;
+	if (khr) {
+		callback = (PFNGLDEBUGMESSAGECALLBACK)get_proc_address("glDebugMessageCallback");
+		control = (PFNGLDEBUGMESSAGECONTROL)get_proc_address("glDebugMessageControl");
+	}
+	if ((!callback || !control) && arb) {
+		khr = false;
+		callback = (PFNGLDEBUGMESSAGECALLBACK)get_proc_address("glDebugMessageCallbackARB");
+		control = (PFNGLDEBUGMESSAGECONTROL)get_proc_address("glDebugMessageControlARB");
+	}
+	if (!callback || !control) {
+		std::cerr << "NOTE: no KHR_debug or GL_ARB_debug_output; GL_ERRORS() will poll glGetError." << std::endl;
+		return false;
+	}
+
+	//ARB_debug_output only reports in debug contexts (KHR_debug can be switched on in any):
+	if (!khr) {
+		GLint flags = 0;
+		glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+		if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT)) {
+			std::cerr << "NOTE: not a debug context, so GL_ARB_debug_output is silent; GL_ERRORS() will poll glGetError." << std::endl;
+			return false;
+		}
+	}
+
+	//report errors only (glGetError's view of things), without GL_DEBUG_OUTPUT_SYNCHRONOUS, so the driver needn't stall:
+	gl_errors("before init_gl_debug_output"); //(the callback won't hear about anything already flagged)
+	control(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+	control(GL_DONT_CARE, GL_DEBUG_TYPE_ERROR, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+	callback(debug_callback, nullptr);
+	if (khr) glEnable(GL_DEBUG_OUTPUT);
+
+	gl_debug_output = true;
+	return true;
+}
+
+#endif
@@ -1,8 +1,23 @@
 #pragma once
 
 #include "GL.hpp"
+#include <atomic>
 #include <iostream>
 
+/*
+ * GL_ERRORS() reports OpenGL errors, tagged with the file and line it was called from.
+ *
+ * Once init_gl_debug_output() has installed a debug-output callback (KHR_debug or GL_ARB_debug_output),
+ *  GL_ERRORS() just notes its location: the driver reports errors to the callback as they happen,
+ *  without the pipeline sync that glGetError can cost. Reporting is asynchronous, so the callback's
+ *  "near <last GL_ERRORS() reached>" is approximate; the driver's message id and text identify the call.
+ * NOTE: errors still set glGetError's flag, and nothing clears it while the callback is installed
+ *  (nothing here polls glGetError then); code that starts polling it should call gl_errors() first.
+ * Without the callback (or if the context has neither extension), GL_ERRORS() polls glGetError as before.
+ *
+ * In release builds (NDEBUG defined), GL_ERRORS() and init_gl_debug_output() compile to nothing.
+ */
+
 #define STR2(X) # X
 #define STR(X) STR2(X)
 
@@ -27,5 +42,28 @@ inline void gl_errors(std::string const &where) {
 		#undef CHECK
 	}
 }
-#define GL_ERRORS() gl_errors(__FILE__  ":" STR(__LINE__) )
 
+#ifdef NDEBUG
+
+inline bool init_gl_debug_output(void *(*get_proc_address)(char const *)) { return false; }
+#define GL_ERRORS() ((void)0)
+
+#else
+
+//install the debug-output callback on the current context; 'get_proc_address' looks up GL entry points
+// (e.g., SDL_GL_GetProcAddress). Returns false (and leaves GL_ERRORS() polling) if the context can't do it:
+bool init_gl_debug_output(void *(*get_proc_address)(char const *));
+
+extern bool gl_debug_output; //callback installed?
+extern std::atomic< char const * > gl_errors_where; //last GL_ERRORS() location (for the callback)
+
+inline void gl_errors_checkpoint(char const *where) {
+	if (gl_debug_output) {
+		gl_errors_where.store(where, std::memory_order_relaxed);
+	} else {
+		gl_errors(where);
+	}
+}
+#define GL_ERRORS() gl_errors_checkpoint(__FILE__  ":" STR(__LINE__) )
+
+#endif
@@ -1,10 +1,17 @@
 #include "load_save_png.hpp"
+#include "ThreadPool.hpp"
 
 #include <png.h>
+#include <zlib.h> //(for Z_RLE)
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
 #include <vector>
 
 #define LOG_ERROR( X ) std::cerr << X << std::endl
@@ -12,7 +19,7 @@
 using std::vector;
 
 bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin);
-void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8vec4 const *data, OriginLocation origin);
+void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8vec4 const *data, OriginLocation origin, PngSaveOptions const &options);
 
 void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin) {
 	assert(size);
@@ -26,9 +33,9 @@ void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 >
 	}
 }
 
-void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin) {
+void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin, PngSaveOptions const &options) {
 	std::ofstream file(filename.c_str(), std::ios::binary);
-	save_png(file, size.x, size.y, data, origin);
+	save_png(file, size.x, size.y, data, origin, options);
 }
 
 
@@ -56,36 +63,63 @@ static void user_flush_data(png_structp png_ptr) {
 	}
 }
 
+namespace {
+	//collects libpng's writes (each chunk header, body, and CRC separately) into large blocks:
+	struct BufferedWriter {
+		std::ostream *to;
+		vector< char > buffer;
+		size_t used;
+		//write out what's buffered (false on error):
+		bool flush() {
+			if (used && !to->write(buffer.data(), used)) return false;
+			used = 0;
+			return true;
+		}
+	};
+}
 
-bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin) {
-	assert(data);
-	uint32_t local_width, local_height;
-	if (width == nullptr) width = &local_width;
-	if (height == nullptr) height = &local_height;
+static void buffered_write_data(png_structp png_ptr, png_bytep data, png_size_t length) {
+	BufferedWriter *to = reinterpret_cast< BufferedWriter * >(png_get_io_ptr(png_ptr));
+	assert(to);
+	if (to->used + length > to->buffer.size()) {
+		if (!to->flush()) png_error(png_ptr, "Error writing.");
+	}
+	if (length >= to->buffer.size()) { //(too big to be worth buffering)
+		if (!to->to->write(reinterpret_cast< char * >(data), length)) png_error(png_ptr, "Error writing.");
+	} else {
+		memcpy(to->buffer.data() + to->used, data, length);
+		to->used += length;
+	}
+}
+
+static void buffered_flush_data(png_structp png_ptr) {
+	//(nothing: the buffer is written out when it fills and after the last chunk)
+}
+
+
+//decode a PNG (read through 'read_fn' from 'io') as RGBA8 into the pixels returned by 'storage' (called once the size is known; return nullptr to bail out):
+static bool read_png(png_rw_ptr read_fn, void *io, unsigned int *width, unsigned int *height, std::function< glm::u8vec4 *(unsigned int w, unsigned int h) > const &storage, OriginLocation origin) {
 	*width = *height = 0;
-	data->clear();
 	//..... load file ......
 	//Load a png file, as per the libpng docs:
 	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)NULL, (png_error_ptr)NULL, (png_error_ptr)NULL);
 
-	png_set_read_fn(png, &from, user_read_data);
-
 	if (!png) {
 		LOG_ERROR("  cannot alloc read struct.");
 		return false;
 	}
+
+	png_set_read_fn(png, io, read_fn);
+
 	png_infop info = png_create_info_struct(png);
 	if (!info) {
 		LOG_ERROR("  cannot alloc info struct.");
 		png_destroy_read_struct(&png, (png_infopp)NULL, (png_infopp)NULL);
 		return false;
 	}
-	png_bytep *row_pointers = NULL;
 	if (setjmp(png_jmpbuf(png))) {
 		LOG_ERROR("  png interal error.");
 		png_destroy_read_struct(&png, &info, (png_infopp)NULL);
-		if (row_pointers != NULL) delete[] row_pointers;
-		data->clear();
 		return false;
 	}
 	//not needed with custom read/write functions: png_init_io(png, NULL);
@@ -103,42 +137,325 @@ bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vec
 	if (png_get_bit_depth(png,info) == 16)
 		png_set_strip_16(png);
 	//Ok, should be 32-bit RGBA now.
+	int passes = png_set_interlace_handling(png);
 
 	png_read_update_info(png, info);
-	size_t rowbytes = png_get_rowbytes(png, info);
 	//Make sure it's the format we think it is...
-	assert(rowbytes == w*sizeof(uint32_t));
+	assert(png_get_rowbytes(png, info) == w*sizeof(uint32_t));
 
-	data->resize(w*h);
-	row_pointers = new png_bytep[h];
-	for (unsigned int r = 0; r < h; ++r) {
-		if (origin == LowerLeftOrigin) {
-			row_pointers[h-1-r] = (png_bytep)(&(*data)[r*w]);
-		} else {
-			row_pointers[r] = (png_bytep)(&(*data)[r*w]);
+	glm::u8vec4 *data = storage(w, h);
+	if (!data) {
+		png_destroy_read_struct(&png, &info, NULL);
+		return false;
+	}
+	//rows are decoded straight into place (no row pointer array; interlaced images take several passes):
+	for (int pass = 0; pass < passes; ++pass) {
+		for (unsigned int r = 0; r < h; ++r) {
+			unsigned int row = (origin == LowerLeftOrigin ? h-1-r : r);
+			png_read_row(png, (png_bytep)(data + size_t(row)*w), NULL);
 		}
 	}
-	png_read_image(png, row_pointers);
+	png_read_end(png, NULL);
 	png_destroy_read_struct(&png, &info, NULL);
-	delete[] row_pointers;
 
 	*width = w;
 	*height = h;
 	return true;
 }
 
+bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin) {
+	assert(data);
+	uint32_t local_width, local_height;
+	if (width == nullptr) width = &local_width;
+	if (height == nullptr) height = &local_height;
+	data->clear();
+	bool ok = read_png(user_read_data, &from, width, height, [data](unsigned int w, unsigned int h) {
+		data->resize(size_t(w)*h);
+		return data->data();
+	}, origin);
+	if (!ok) data->clear();
+	return ok;
+}
+
+namespace {
+	struct MemoryReader {
+		uint8_t const *data;
+		size_t size;
+		size_t offset;
+	};
+}
+
+static void memory_read_data(png_structp png_ptr, png_bytep data, png_size_t length) {
+	MemoryReader *from = reinterpret_cast< MemoryReader * >(png_get_io_ptr(png_ptr));
+	assert(from);
+	if (length > from->size - from->offset) {
+		png_error(png_ptr, "Error reading (past end of data).");
+	}
+	memcpy(data, from->data + from->offset, length);
+	from->offset += length;
+}
+
+bool png_size(uint8_t const *data, size_t bytes, glm::uvec2 *size) {
+	assert(size);
+	//signature, then the IHDR chunk (length, type, then big-endian width and height):
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	if (bytes < 24 || memcmp(data, signature, 8) != 0 || memcmp(data + 12, "IHDR", 4) != 0) return false;
+	auto be32 = [](uint8_t const *b) {
+		return (uint32_t(b[0]) << 24) | (uint32_t(b[1]) << 16) | (uint32_t(b[2]) << 8) | uint32_t(b[3]);
+	};
+	*size = glm::uvec2(be32(data + 16), be32(data + 20));
+	return true;
+}
+
+bool load_png(uint8_t const *data, size_t bytes, glm::uvec2 const &size, glm::u8vec4 *into, OriginLocation origin) {
+	assert(into);
+	MemoryReader from{ data, bytes, 0 };
+	unsigned int w, h;
+	return read_png(memory_read_data, &from, &w, &h, [&](unsigned int w_, unsigned int h_) {
+		return (w_ == size.x && h_ == size.y ? into : nullptr);
+	}, origin);
+}
+
+
+//---- striped encoder ----
+//PNG's IDAT data is a single zlib stream of filtered rows. Strips are deflated independently,
+// each ending in a sync flush (so it finishes on a byte boundary with no final block),
+// which lets their outputs be concatenated; the per-strip Adler-32s are combined for the trailer.
+
+namespace {
+	struct Strip {
+		uint32_t begin, end; //rows (in file order, top first)
+		vector< uint8_t > out; //raw deflate data (strip 0 also gets the zlib header)
+		uLong adler = 0; //of the strip's filtered rows
+		bool ok = false;
+	};
+}
+
+static uint8_t paeth_predictor(int a, int b, int c) {
+	int p = a + b - c;
+	int pa = std::abs(p - a);
+	int pb = std::abs(p - b);
+	int pc = std::abs(p - c);
+	if (pa <= pb && pa <= pc) return uint8_t(a);
+	if (pb <= pc) return uint8_t(b);
+	return uint8_t(c);
+}
+
+//write filter byte 'type' and the filtered 'row' ('up' is the row above, zeros for the first row) to 'out':
+static void filter_row(uint8_t type, uint8_t const *row, uint8_t const *up, size_t bytes, uint8_t *out) {
+	const size_t bpp = 4; //(RGBA8)
+	out[0] = type;
+	++out;
+	//(one loop per type, with the first pixel -- which has nothing to its left -- peeled off, so the loops don't branch per byte)
+	if (type == PNG_FILTER_VALUE_SUB) {
+		std::memcpy(out, row, bpp);
+		for (size_t i = bpp; i < bytes; ++i) out[i] = uint8_t(row[i] - row[i - bpp]);
+	} else if (type == PNG_FILTER_VALUE_UP) {
+		for (size_t i = 0; i < bytes; ++i) out[i] = uint8_t(row[i] - up[i]);
+	} else if (type == PNG_FILTER_VALUE_AVG) {
+		for (size_t i = 0; i < bpp; ++i) out[i] = uint8_t(row[i] - up[i] / 2);
+		for (size_t i = bpp; i < bytes; ++i) out[i] = uint8_t(row[i] - (row[i - bpp] + up[i]) / 2);
+	} else if (type == PNG_FILTER_VALUE_PAETH) {
+		for (size_t i = 0; i < bpp; ++i) out[i] = uint8_t(row[i] - up[i]); //(paeth of (0, up, 0) is up)
+		for (size_t i = bpp; i < bytes; ++i) out[i] = uint8_t(row[i] - paeth_predictor(row[i - bpp], up[i], up[i - bpp]));
+	} else {
+		std::memcpy(out, row, bytes);
+	}
+}
+
+//(the same heuristic as libpng's adaptive filtering: smallest sum of bytes read as signed;
+// like libpng, gives up -- returning something >= 'limit' -- once the row can't beat 'limit')
+static uint32_t filtered_cost(uint8_t const *filtered, size_t bytes, uint32_t limit) {
+	uint32_t cost = 0;
+	for (size_t i = 1; i <= bytes; ++i) {
+		cost += uint32_t(std::abs(int(int8_t(filtered[i]))));
+		if ((i & 255) == 0 && cost >= limit) break;
+	}
+	return cost;
+}
+
+//deflate what's at z.next_in onto the end of 'out' (which has 'used' bytes so far), growing it as needed:
+static bool deflate_onto(z_stream &z, vector< uint8_t > &out, size_t &used, int flush) {
+	while (true) {
+		if (out.size() - used < 4096) out.resize(out.size() * 2 + 4096);
+		z.next_out = out.data() + used;
+		z.avail_out = uInt(out.size() - used);
+		int ret = deflate(&z, flush);
+		used = out.size() - z.avail_out;
+		if (ret == Z_STREAM_ERROR) return false;
+		//(done once deflate leaves some output space unused, i.e., has nothing more to say)
+		if (z.avail_in == 0 && z.avail_out != 0) return true;
+	}
+}
+
+static void encode_strip(Strip &strip, std::function< uint8_t const *(uint32_t) > const &row_at, unsigned int width, PngSaveOptions const &options, bool first) {
+	size_t bytes = size_t(width) * 4;
+	vector< uint8_t > zeros(bytes, 0);
+	vector< uint8_t > filtered(1 + bytes);
+	vector< uint8_t > trial(options.filter == PngSaveOptions::AdaptiveFilter ? 1 + bytes : 0);
+
+	z_stream z;
+	std::memset(&z, 0, sizeof(z));
+	int level = (options.compression_level >= 0 ? options.compression_level : Z_DEFAULT_COMPRESSION);
+	//(libpng also defaults to Z_FILTERED when rows are filtered)
+	int strategy = (options.run_length ? Z_RLE : (options.filter == PngSaveOptions::NoFilter ? Z_DEFAULT_STRATEGY : Z_FILTERED));
+	if (deflateInit2(&z, level, Z_DEFLATED, -15, 8, strategy) != Z_OK) return; //(raw deflate: the zlib header and trailer are written separately)
+
+	size_t used = 0;
+	if (first) {
+		//zlib header: deflate with a 32k window, FLEVEL hinting at the level, check bits making it a multiple of 31:
+		int flevel = (level == 0 || level == 1 ? 0 : (level >= 2 && level <= 5 ? 1 : (level == 6 || level == Z_DEFAULT_COMPRESSION ? 2 : 3)));
+		uint16_t header = uint16_t((0x78 << 8) | (flevel << 6));
+		header += uint16_t(31 - header % 31);
+		strip.out.resize(2);
+		strip.out[0] = uint8_t(header >> 8);
+		strip.out[1] = uint8_t(header & 0xff);
+		used = 2;
+	}
+
+	bool ok = true;
+	strip.adler = adler32(0L, Z_NULL, 0);
+	for (uint32_t y = strip.begin; y < strip.end && ok; ++y) {
+		uint8_t const *row = row_at(y);
+		uint8_t const *up = (y > 0 ? row_at(y - 1) : zeros.data());
+		if (options.filter == PngSaveOptions::AdaptiveFilter) {
+			uint32_t best = uint32_t(-1);
+			for (uint8_t type = PNG_FILTER_VALUE_NONE; type < PNG_FILTER_VALUE_LAST; ++type) {
+				filter_row(type, row, up, bytes, trial.data());
+				uint32_t cost = filtered_cost(trial.data(), bytes, best);
+				if (cost < best) {
+					best = cost;
+					std::swap(trial, filtered);
+				}
+			}
+		} else {
+			static const uint8_t types[] = { PNG_FILTER_VALUE_NONE, PNG_FILTER_VALUE_NONE, PNG_FILTER_VALUE_SUB, PNG_FILTER_VALUE_UP, PNG_FILTER_VALUE_AVG, PNG_FILTER_VALUE_PAETH };
+			filter_row(types[options.filter], row, up, bytes, filtered.data());
+		}
+		strip.adler = adler32(strip.adler, filtered.data(), uInt(filtered.size()));
+		z.next_in = filtered.data();
+		z.avail_in = uInt(filtered.size());
+		ok = deflate_onto(z, strip.out, used, Z_NO_FLUSH);
+	}
+	//sync flush ends the strip byte-aligned, without a final block, so the next strip's data can follow it:
+	if (ok) ok = deflate_onto(z, strip.out, used, Z_SYNC_FLUSH);
+	deflateEnd(&z);
+	strip.out.resize(used);
+	strip.ok = ok;
+}
+
+static void write_chunk(std::ostream &to, char const *type, uint8_t const *data, size_t length) {
+	uint8_t header[8] = {
+		uint8_t(length >> 24), uint8_t(length >> 16), uint8_t(length >> 8), uint8_t(length),
+		uint8_t(type[0]), uint8_t(type[1]), uint8_t(type[2]), uint8_t(type[3])
+	};
+	uLong crc = crc32(0L, header + 4, 4);
+	if (length) crc = crc32(crc, data, uInt(length));
+	uint8_t footer[4] = { uint8_t(crc >> 24), uint8_t(crc >> 16), uint8_t(crc >> 8), uint8_t(crc) };
+	to.write(reinterpret_cast< char const * >(header), 8);
+	if (length) to.write(reinterpret_cast< char const * >(data), length);
+	to.write(reinterpret_cast< char const * >(footer), 4);
+}
+
+//how many threads the striped encoder would use for 'options' (1 => just use libpng):
+static uint32_t striped_threads(PngSaveOptions const &options) {
+	if (options.threads != 0) return options.threads;
+	return std::max(1U, std::thread::hardware_concurrency());
+}
+
+//strips after the first go to workers that stay up between saves, so each save doesn't pay to start and join threads.
+// (strip 0 runs on the calling thread, hence one worker fewer than hardware threads)
+static ThreadPool &strip_pool() {
+	static ThreadPool pool(std::max(2U, std::thread::hardware_concurrency()) - 1);
+	return pool;
+}
+
+static void save_png_striped(std::ostream &to, unsigned int width, unsigned int height, glm::u8vec4 const *data, OriginLocation origin, PngSaveOptions const &options) {
+	auto row_at = [&](uint32_t y) -> uint8_t const * {
+		uint32_t row = (origin == UpperLeftOrigin ? y : height - 1 - y);
+		return reinterpret_cast< uint8_t const * >(data + size_t(row) * width);
+	};
+
+	uint32_t threads = striped_threads(options);
+	//at least 64 rows per strip, so small images aren't split into pieces that compress badly:
+	uint32_t count = std::max(1U, std::min(threads, height / 64));
+	vector< Strip > strips(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		strips[i].begin = uint32_t(uint64_t(height) * i / count);
+		strips[i].end = uint32_t(uint64_t(height) * (i + 1) / count);
+	}
+
+	//strip 0 on this thread, the rest on the pool:
+	if (count > 1) {
+		ThreadPool &pool = strip_pool();
+		for (uint32_t i = 1; i < count; ++i) {
+			Strip *strip = &strips[i];
+			pool.submit([strip, &row_at, width, &options]() {
+				encode_strip(*strip, row_at, width, options, false);
+			});
+		}
+		encode_strip(strips[0], row_at, width, options, true);
+		//(also waits on any other thread's strips in the pool at the same time -- harmless, just shared)
+		pool.wait();
+	} else {
+		encode_strip(strips[0], row_at, width, options, true);
+	}
+
+	uLong adler = adler32(0L, Z_NULL, 0);
+	for (auto const &strip : strips) {
+		if (!strip.ok) {
+			LOG_ERROR("Error compressing png.");
+			return;
+		}
+		size_t strip_bytes = size_t(strip.end - strip.begin) * (1 + size_t(width) * 4);
+		adler = adler32_combine(adler, strip.adler, z_off_t(strip_bytes));
+	}
+
+	//an empty final fixed-Huffman block (BFINAL = 1, BTYPE = 01, then the end-of-block code) ends the stream, then the zlib trailer:
+	vector< uint8_t > &last = strips.back().out;
+	last.insert(last.end(), { 0x03, 0x00 });
+	last.insert(last.end(), { uint8_t(adler >> 24), uint8_t(adler >> 16), uint8_t(adler >> 8), uint8_t(adler) });
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	to.write(reinterpret_cast< char const * >(signature), 8);
+	uint8_t ihdr[13] = {
+		uint8_t(width >> 24), uint8_t(width >> 16), uint8_t(width >> 8), uint8_t(width),
+		uint8_t(height >> 24), uint8_t(height >> 16), uint8_t(height >> 8), uint8_t(height),
+		8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE, PNG_INTERLACE_NONE
+	};
+	write_chunk(to, "IHDR", ihdr, sizeof(ihdr));
+	for (auto const &strip : strips) {
+		write_chunk(to, "IDAT", strip.out.data(), strip.out.size());
+	}
+	write_chunk(to, "IEND", nullptr, 0);
+	if (!to.flush()) {
+		LOG_ERROR("Error writing png.");
+	}
+}
+
+
+void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8vec4 const *data, OriginLocation origin, PngSaveOptions const &options) {
+	//(when that comes to one thread -- e.g., threads = 0 on a one-core machine -- libpng alone is faster)
+	if (striped_threads(options) != 1) {
+		save_png_striped(to, width, height, data, origin, options);
+		return;
+	}
 
-void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8vec4 const *data, OriginLocation origin) {
 //After the libpng example.c
 	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 
-	png_set_write_fn(png_ptr, &to, user_write_data, user_flush_data);
-
 	if (png_ptr == NULL) {
 		LOG_ERROR("Can't create write struct.");
 		return;
 	}
 
+	BufferedWriter writer{ &to, vector< char >(options.buffer_size), 0 };
+	if (options.buffer_size) {
+		png_set_write_fn(png_ptr, &writer, buffered_write_data, buffered_flush_data);
+	} else {
+		png_set_write_fn(png_ptr, &to, user_write_data, user_flush_data);
+	}
+
 	png_infop info_ptr = png_create_info_struct(png_ptr);
 	if (info_ptr == NULL) {
 		png_destroy_write_struct(&png_ptr, NULL);
@@ -155,6 +472,17 @@ void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8
 	//Not needed with custom read/write functions: png_init_io(png_ptr, fp);
 	png_set_IHDR(png_ptr, info_ptr, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
+	if (options.compression_level >= 0) {
+		png_set_compression_level(png_ptr, options.compression_level);
+	}
+	if (options.run_length) {
+		png_set_compression_strategy(png_ptr, Z_RLE);
+	}
+	static const int filters[] = { PNG_ALL_FILTERS, PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP, PNG_FILTER_AVG, PNG_FILTER_PAETH };
+	png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, filters[options.filter]);
+	//(bigger IDAT chunks => fewer chunk headers + CRCs)
+	png_set_compression_buffer_size(png_ptr, 1 << 16);
+
 	png_write_info(png_ptr, info_ptr);
 	//png_set_swap_alpha(png_ptr) // might need?
 	vector< png_bytep > row_pointers(height);
@@ -171,5 +499,9 @@ void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8
 
 	png_destroy_write_struct(&png_ptr, &info_ptr);
 
+	if (options.buffer_size && !writer.flush()) {
+		LOG_ERROR("Error writing png.");
+	}
+
 	return;
 }
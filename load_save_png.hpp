@@ -15,6 +15,46 @@ enum OriginLocation {
 	UpperLeftOrigin,
 };
 
+//how save_png trades file size for speed:
+struct PngSaveOptions {
+	//zlib level: 0 (store) to 9 (smallest); -1 => zlib's default (6):
+	int compression_level = -1;
+	//row filter (PNG's per-row prediction); adaptive tries every filter on every row (smaller, slower):
+	enum Filter : uint8_t {
+		AdaptiveFilter,
+		NoFilter,
+		SubFilter,
+		UpFilter,
+		AverageFilter,
+		PaethFilter,
+	} filter = AdaptiveFilter;
+	//only look for runs of repeated bytes (zlib's Z_RLE): skips the match search, and filtered flat-colored frames are mostly runs:
+	bool run_length = false;
+	//libpng's many small writes are collected into blocks of this many bytes (0 => write each through):
+	size_t buffer_size = 1 << 16;
+	//encode on this many threads (0 => one per hardware thread). More than one uses the striped encoder,
+	// which compresses horizontal strips in parallel (on a pool kept between saves) and joins them into one IDAT stream
+	// (files come out slightly larger, since no strip can refer back into the one above it):
+	uint32_t threads = 1;
+
+	//preset for bulk dumping (e.g., captures): much faster to write, somewhat larger files.
+	// (about 4x faster than the defaults on one thread: at level 1, deflate itself is most of what's left,
+	//  so more speed means more threads -- see 'threads' -- or no compression: level 0 + NoFilter is ~15x, at ~10x the size)
+	static PngSaveOptions fast() {
+		PngSaveOptions options;
+		options.compression_level = 1;
+		options.filter = UpFilter;
+		options.run_length = true;
+		return options;
+	}
+};
+
 //NOTE: load_png will throw on error
 void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin);
-void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin);
+void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin, PngSaveOptions const &options = PngSaveOptions());
+
+//read the width and height from the header of the PNG in data[0,bytes) (false if it doesn't look like a PNG):
+bool png_size(uint8_t const *data, size_t bytes, glm::uvec2 *size);
+//decode the PNG in data[0,bytes) straight into 'into' (size.x * size.y pixels, e.g. a mapped buffer); 'size' must match the header.
+// returns false on error (safe to call from any thread):
+bool load_png(uint8_t const *data, size_t bytes, glm::uvec2 const &size, glm::u8vec4 *into, OriginLocation origin);
@@ -4,12 +4,34 @@
 //The 'GameMode' mode plays the game:
 #include "SnakeMode.hpp"
 
+//for --record / --play:
+#include "Replay.hpp"
+
+//for --profile:
+#include "Profiler.hpp"
+
+//for --trace:
+#include "Trace.hpp"
+
+//for --headless:
+#include "Headless.hpp"
+
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
 
+//for init_gl_debug_output:
+#include "gl_errors.hpp"
+
+//for --capture:
+#include "Capture.hpp"
+
 //for screenshots:
+#include "Screenshots.hpp"
 #include "load_save_png.hpp"
 
+//for --floor:
+#include "TextureLoader.hpp"
+
 //Includes for libSDL:
 #include <SDL.h>
 
@@ -19,6 +41,10 @@
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <string>
+#include <ctime>
+#include <cstdio>
+#include <cmath>
 
 int main(int argc, char **argv) {
 #ifdef _WIN32
@@ -26,6 +52,169 @@ int main(int argc, char **argv) {
 	try {
 #endif
 
+	//------------ command line ------------
+
+	float tick_rate = 0.0f; //fixed updates per second (0 => one variable-length update per frame)
+	uint32_t seed = static_cast< uint32_t >(time(NULL)); //seed for the first game (later games count up from here)
+	std::string record_path; //save each game's inputs here (game 0 to record_path, later games to record_path.1, .2, ...)
+	std::string play_path; //play back this recording without a window, then exit
+	SnakeMode::CircleStyle circle_style = SnakeMode::FanCircles;
+	bool profile = false; //time CPU + GPU work per frame (shown in an overlay and the window title)
+	std::string profile_csv; //...and log the timings here
+	std::string trace_path; //record trace zones, written here on exit (and on F9)
+	bool trace_detail = false; //...including the fine-grained ones (e.g., each pass of the update)
+	uint32_t headless_frames = 0; //draw this many frames without a window, then exit
+	glm::uvec2 headless_size = glm::uvec2(640, 480); //...at this size
+	std::string headless_png; //...and save the last one here
+	std::string capture_path; //record every frame to this Y4M video
+	std::string floor_path; //PNG to draw on the arena floor
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--tick-rate" && i + 1 < argc) {
+			tick_rate = std::stof(argv[++i]);
+		} else if (arg == "--seed" && i + 1 < argc) {
+			seed = static_cast< uint32_t >(std::stoul(argv[++i]));
+		} else if (arg == "--record" && i + 1 < argc) {
+			record_path = argv[++i];
+		} else if (arg == "--play" && i + 1 < argc) {
+			play_path = argv[++i];
+		} else if (arg == "--profile") {
+			profile = true;
+		} else if (arg == "--profile-csv" && i + 1 < argc) {
+			profile = true;
+			profile_csv = argv[++i];
+		} else if (arg == "--trace" && i + 1 < argc) {
+			trace_path = argv[++i];
+		} else if (arg == "--trace-detail") {
+			trace_detail = true;
+		} else if (arg == "--headless" && i + 1 < argc) {
+			headless_frames = static_cast< uint32_t >(std::stoul(argv[++i]));
+		} else if (arg == "--size" && i + 1 < argc && sscanf(argv[i+1], "%ux%u", &headless_size.x, &headless_size.y) == 2) {
+			++i;
+		} else if (arg == "--headless-png" && i + 1 < argc) {
+			headless_png = argv[++i];
+		} else if (arg == "--capture" && i + 1 < argc) {
+			capture_path = argv[++i];
+		} else if (arg == "--floor" && i + 1 < argc) {
+			floor_path = argv[++i];
+		} else if (arg == "--circles" && i + 1 < argc && std::string(argv[i+1]) == "fan") {
+			circle_style = SnakeMode::FanCircles;
+			++i;
+		} else if (arg == "--circles" && i + 1 < argc && std::string(argv[i+1]) == "sdf") {
+			circle_style = SnakeMode::SdfCircles;
+			++i;
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--tick-rate <hz>] [--seed <n>] [--record <file>] [--circles fan|sdf] [--floor <file.png>] [--profile] [--profile-csv <file>] [--trace <file> [--trace-detail]] [--capture <file.y4m>]\n\t" << argv[0] << " --play <file>\n\t" << argv[0] << " --headless <frames> [--size <w>x<h>] [--headless-png <file>] [--capture <file.y4m>] [--tick-rate <hz>] [--seed <n>] [--circles fan|sdf] [--floor <file.png>]" << std::endl;
+			return 1;
+		}
+	}
+
+	if (!trace_path.empty()) {
+#ifndef BSNAKE_TRACE
+		std::cerr << "NOTE: built without BSNAKE_TRACE, so '" << trace_path << "' will have no zones in it." << std::endl;
+#endif
+		trace::enabled = true;
+		trace::detail = trace_detail;
+		trace::set_thread_name("main");
+	}
+
+	//frames per second to label captured video with. Frames come at whatever rate the display (or headless loop) manages,
+	// so while capturing, every frame advances the game by exactly 1 / capture_fps (video time is game time):
+	uint32_t capture_fps = (tick_rate > 0.0f ? uint32_t(std::round(tick_rate)) : 60);
+
+	//------------ headless playback ------------
+
+	if (!play_path.empty()) {
+		Replay replay = Replay::load(play_path);
+		auto before = std::chrono::high_resolution_clock::now();
+		SnakeSim sim(replay.seed);
+		uint64_t updates = replay.play(&sim);
+		auto after = std::chrono::high_resolution_clock::now();
+
+		std::cout << "Played '" << play_path << "' (seed " << replay.seed << "): "
+			<< updates << " updates, " << sim.time << "s of game time in "
+			<< std::chrono::duration< double, std::milli >(after - before).count() << "ms." << std::endl;
+		std::cout << "Snake " << (!sim.over ? "was still playing" : (sim.escaped() ? "escaped" : "crashed"))
+			<< " after eating " << sim.foods_eaten << " food (radius " << sim.snake_r << ")." << std::endl;
+		if (!trace_path.empty()) trace::dump(trace_path);
+		return 0;
+	}
+
+	//------------ headless rendering ------------
+
+	if (headless_frames > 0) {
+		//(no SDL window: draws into an offscreen framebuffer, one fixed-length update per frame)
+		Headless headless(headless_size);
+		init_GL();
+		init_gl_debug_output(Headless::get_proc_address);
+
+		GLuint floor_tex = 0;
+		if (!floor_path.empty()) {
+			//(every frame should look the same from run to run, so wait for the floor instead of streaming it in)
+			TextureLoader texture_loader;
+			floor_tex = texture_loader.load(floor_path);
+			texture_loader.finish();
+		}
+
+		std::shared_ptr< SnakeMode > game = std::make_shared< SnakeMode >(seed);
+		game->tick = 1.0f / (tick_rate > 0.0f ? tick_rate : 60.0f);
+		game->circle_style = circle_style;
+		game->floor_tex = floor_tex;
+		Mode::set_current(game);
+
+		std::unique_ptr< Capture > capture;
+		if (!capture_path.empty()) {
+			std::cout << "Capturing frames to '" << capture_path << "'." << std::endl;
+			capture.reset(new Capture(capture_path, headless_size, capture_fps));
+		}
+
+		auto before = std::chrono::high_resolution_clock::now();
+		uint32_t frames = 0;
+		while (frames < headless_frames && Mode::current) {
+			{
+				TRACE_ZONE("update");
+				Mode::current->update(Mode::current->tick);
+			}
+			if (!Mode::current) break;
+			{
+				TRACE_ZONE("draw");
+				Mode::current->draw(headless_size);
+			}
+			if (capture) {
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, headless.framebuffer);
+				capture->frame(GL_COLOR_ATTACHMENT0);
+			}
+			++frames;
+		}
+		capture.reset(); //(waits for the last frames to be written)
+		glFinish();
+		auto after = std::chrono::high_resolution_clock::now();
+		double seconds = std::chrono::duration< double >(after - before).count();
+		std::cout << "Drew " << frames << " frames at " << headless_size.x << "x" << headless_size.y << " in "
+			<< seconds * 1000.0 << "ms (" << frames / std::max(seconds, 1e-9) << " frames/s)." << std::endl;
+
+		if (!headless_png.empty()) {
+			std::cout << "Saving last frame to '" << headless_png << "'." << std::endl;
+			std::vector< glm::u8vec4 > data(headless_size.x * headless_size.y);
+			headless.read_pixels(data.data());
+			for (auto &px : data) {
+				px.a = 0xff;
+			}
+			//(headless frames can be huge -- e.g., 8K views of the whole arena -- so encode on every core)
+			PngSaveOptions options;
+			options.threads = 0;
+			save_png(headless_png, headless_size, data.data(), LowerLeftOrigin, options);
+		}
+
+		if (!trace_path.empty()) trace::dump(trace_path);
+
+		Mode::set_current(nullptr);
+		game.reset(); //(before the context goes away)
+		glDeleteTextures(1, &floor_tex);
+		return 0;
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -41,7 +230,9 @@ int main(int argc, char **argv) {
 	SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
 	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+#ifndef NDEBUG
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+#endif
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
 
@@ -75,6 +266,9 @@ int main(int argc, char **argv) {
 	//On windows, load OpenGL entrypoints: (does nothing on other platforms)
 	init_GL();
 
+	//have the driver report GL errors as they happen, instead of GL_ERRORS() polling for them: (does nothing in release builds)
+	init_gl_debug_output(SDL_GL_GetProcAddress);
+
 	//Set VSYNC + Late Swap (prevents crazy FPS):
 	if (SDL_GL_SetSwapInterval(-1) != 0) {
 		std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
@@ -83,11 +277,45 @@ int main(int argc, char **argv) {
 		}
 	}
 
+	//------------ profiling ------------
+	std::unique_ptr< Profiler > profiler;
+	if (profile) {
+		profiler.reset(new Profiler(profile_csv));
+		Profiler::current = profiler.get();
+	}
+
+	//------------ screenshots ------------
+	std::unique_ptr< Screenshots > screenshots(new Screenshots());
+
+	//------------ art ------------
+	//(decoded in the background; the floor is transparent until poll() uploads it a frame or so later)
+	std::unique_ptr< TextureLoader > texture_loader(new TextureLoader());
+	GLuint floor_tex = 0;
+	if (!floor_path.empty()) floor_tex = texture_loader->load(floor_path);
+
 	//Hide mouse cursor (note: showing can be useful for debugging):
 	//SDL_ShowCursor(SDL_DISABLE);
 
 	//------------ create game mode + make current --------------
-	Mode::set_current(std::make_shared< SnakeMode >());
+	std::shared_ptr< SnakeMode > game; //(kept here so its recording can be saved after Mode::current moves on)
+	uint32_t games = 0;
+	auto save_recording = [&]() {
+		if (!game || record_path.empty()) return;
+		std::string filename = record_path;
+		if (games > 1) filename += "." + std::to_string(games - 1);
+		std::cout << "Saving recording of game with seed " << game->recording.seed << " to '" << filename << "'." << std::endl;
+		game->recording.save(filename);
+	};
+	auto new_game = [&]() {
+		save_recording();
+		game = std::make_shared< SnakeMode >(seed++);
+		games += 1;
+		if (tick_rate > 0.0f) game->tick = 1.0f / tick_rate;
+		game->circle_style = circle_style;
+		game->floor_tex = floor_tex;
+		Mode::set_current(game);
+	};
+	new_game();
 
 	//------------ main loop ------------
 
@@ -106,12 +334,25 @@ int main(int argc, char **argv) {
 	};
 	on_resize();
 
+	//------------ capture ------------
+	std::unique_ptr< Capture > capture;
+	if (!capture_path.empty()) {
+		//(the video's size is fixed, so the window's has to be too)
+		SDL_SetWindowResizable(window, SDL_FALSE);
+		std::cout << "Capturing frames to '" << capture_path << "'." << std::endl;
+		capture.reset(new Capture(capture_path, drawable_size, capture_fps));
+	}
+
 	//This will loop until the current mode is set to null:
 	while (Mode::current) {
 		//every pass through the game loop creates one frame of output
 		//  by performing three steps:
 
+		if (profiler) profiler->begin_frame();
+
 		{ //(1) process any events that are pending
+			Profiler::Scope profile_events(Profiler::EventsSection);
+			TRACE_ZONE("events");
 			static SDL_Event evt;
 			while (SDL_PollEvent(&evt) == 1) {
 				//handle resizing:
@@ -129,24 +370,26 @@ int main(int argc, char **argv) {
 					std::string filename = "screenshot.png";
 					std::cout << "Saving screenshot to '" << filename << "'." << std::endl;
 					glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-					glReadBuffer(GL_FRONT);
 					int w,h;
 					SDL_GL_GetDrawableSize(window, &w, &h);
-					std::vector< glm::u8vec4 > data(w*h);
-					glReadPixels(0,0,w,h, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
-					for (auto &px : data) {
-						px.a = 0xff;
-					}
-					save_png(filename, glm::uvec2(w,h), data.data(), LowerLeftOrigin);
+					//(read back asynchronously; written out by a background thread a frame or so later)
+					Profiler::Scope profile_screenshot(Profiler::ScreenshotPass);
+					screenshots->request(filename, glm::uvec2(w,h), GL_FRONT);
+				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F9 && !trace_path.empty()) {
+					// --- trace key (write out the zones so far) ---
+					std::cout << "Saving trace to '" << trace_path << "'." << std::endl;
+					trace::dump(trace_path);
 				}
         else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_SPACE) {
-          Mode::set_current(std::make_shared< SnakeMode >());
+          new_game();
         }
 			}
 			if (!Mode::current) break;
 		}
 
 		{ //(2) call the current mode's "update" function to deal with elapsed time:
+			Profiler::Scope profile_update(Profiler::UpdateSection);
+			TRACE_ZONE("update");
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
 			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
@@ -156,22 +399,102 @@ int main(int argc, char **argv) {
 			//lag to avoid spiral of death:
 			elapsed = std::min(0.1f, elapsed);
 
-			Mode::current->update(elapsed);
+			//captured frames are labeled capture_fps, so step by exactly that (see above):
+			if (capture) elapsed = 1.0f / float(capture_fps);
+
+			if (Mode::current->tick > 0.0f) {
+				//fixed-step: run as many whole ticks as have elapsed, carry the remainder to the next frame:
+				static float accumulated = 0.0f;
+				static std::weak_ptr< Mode > accumulated_for;
+				if (accumulated_for.lock() != Mode::current) {
+					//new mode: start its clock fresh
+					accumulated = 0.0f;
+					accumulated_for = Mode::current;
+				}
+				accumulated += elapsed;
+				std::shared_ptr< Mode > mode = Mode::current;
+				while (accumulated >= mode->tick && Mode::current == mode) {
+					accumulated -= mode->tick;
+					mode->update(mode->tick);
+				}
+				mode->tick_alpha = accumulated / mode->tick;
+			} else {
+				Mode::current->update(elapsed);
+			}
 			if (!Mode::current) break;
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
+			{
+				Profiler::Scope profile_draw(Profiler::DrawSection);
+				TRACE_ZONE("draw");
+				Mode::current->draw(drawable_size);
+			}
+
+			if (capture) {
+				//(read back before swapping, while the frame is still in the back buffer -- and before the profiler overlay, so it stays out of the video)
+				Profiler::Scope profile_capture(Profiler::ScreenshotPass);
+				glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+				capture->frame(GL_BACK);
+			}
+
+			if (profiler) profiler->draw_overlay(drawable_size);
+		}
 
-			Mode::current->draw(drawable_size);
+		{ //Wait until the recently-drawn frame is shown before doing it all again:
+			Profiler::Scope profile_swap_cpu(Profiler::SwapSection);
+			Profiler::Scope profile_swap_gpu(Profiler::SwapPass);
+			TRACE_ZONE("swap");
+			SDL_GL_SwapWindow(window);
 		}
 
-		//Wait until the recently-drawn frame is shown before doing it all again:
-		SDL_GL_SwapWindow(window);
+		screenshots->poll();
+		texture_loader->poll();
+
+		if (profiler) {
+			profiler->end_frame();
+
+			//show the latest timings in the window title, twice a second:
+			static auto title_time = std::chrono::high_resolution_clock::now();
+			auto now = std::chrono::high_resolution_clock::now();
+			if (profiler->completed > 0 && now - title_time > std::chrono::milliseconds(500)) {
+				title_time = now;
+				Profiler::Result const &r = profiler->latest();
+				float cpu = 0.0f, gpu = 0.0f;
+				for (float ms : r.cpu_ms) cpu += ms;
+				for (float ms : r.gpu_ms) gpu += std::max(ms, 0.0f);
+				char title[128];
+				snprintf(title, sizeof(title), "Blind Snake | cpu %.2fms (draw %.2fms) | gpu %.2fms (draw %.2fms)",
+					cpu, r.cpu_ms[Profiler::DrawSection], gpu, std::max(r.gpu_ms[Profiler::DrawPass], 0.0f));
+				SDL_SetWindowTitle(window, title);
+			}
+		}
 	}
 
 
 	//------------  teardown ------------
 
+	save_recording();
+	game.reset();
+
+	texture_loader.reset(); //(before the context goes away)
+	glDeleteTextures(1, &floor_tex);
+
+	if (!trace_path.empty()) {
+		std::cout << "Saving trace to '" << trace_path << "'." << std::endl;
+		trace::dump(trace_path);
+	}
+
+	Profiler::current = nullptr;
+	profiler.reset(); //(before the context goes away; waits for the last GPU timings)
+
+	screenshots.reset(); //(before the context goes away; waits for the last screenshots to be saved)
+
+	if (capture) {
+		std::cout << "Captured " << capture->frames << " frames to '" << capture_path << "'." << std::endl;
+		capture.reset(); //(before the context goes away; waits for the last frames to be written)
+	}
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 
@@ -0,0 +1,84 @@
+//bsnake-rollouts plays many games without a window and prints one CSV line per game:
+#include "Rollouts.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <ctime>
+
+int main(int argc, char **argv) {
+	uint32_t first_seed = static_cast< uint32_t >(time(NULL));
+	uint32_t games = 1000;
+	uint32_t max_steps = 60 * 60 * 10; //ten minutes at the default tick rate
+	float tick_rate = 60.0f;
+	uint32_t threads = 0;
+	std::string trace_path; //write the workers' trace zones here when done
+	bool trace_detail = false; //...including every update (expensive: millions of tiny zones)
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--seed" && i + 1 < argc) {
+			first_seed = static_cast< uint32_t >(std::stoul(argv[++i]));
+		} else if (arg == "--games" && i + 1 < argc) {
+			games = static_cast< uint32_t >(std::stoul(argv[++i]));
+		} else if (arg == "--steps" && i + 1 < argc) {
+			max_steps = static_cast< uint32_t >(std::stoul(argv[++i]));
+		} else if (arg == "--tick-rate" && i + 1 < argc) {
+			tick_rate = std::stof(argv[++i]);
+		} else if (arg == "--threads" && i + 1 < argc) {
+			threads = static_cast< uint32_t >(std::stoul(argv[++i]));
+		} else if (arg == "--trace" && i + 1 < argc) {
+			trace_path = argv[++i];
+		} else if (arg == "--trace-detail") {
+			trace_detail = true;
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--seed <n>] [--games <n>] [--steps <n>] [--tick-rate <hz>] [--threads <n>] [--trace <file> [--trace-detail]]" << std::endl;
+			return 1;
+		}
+	}
+	if (!(tick_rate > 0.0f)) {
+		std::cerr << "--tick-rate must be positive." << std::endl;
+		return 1;
+	}
+
+	//baseline bot: keep the mouth shut and head straight for the exit:
+	RolloutPolicy beeline = [](SnakeSim &sim) {
+		sim.snake_mouth_open = false;
+		sim.steer(sim.exit_pos - sim.snake_pos);
+	};
+
+	if (!trace_path.empty()) {
+#ifndef BSNAKE_TRACE
+		std::cerr << "NOTE: built without BSNAKE_TRACE, so '" << trace_path << "' will have no zones in it." << std::endl;
+#endif
+		trace::enabled = true;
+		trace::detail = trace_detail;
+		trace::set_thread_name("main");
+	}
+
+	ThreadPool pool(threads);
+
+	auto before = std::chrono::steady_clock::now();
+	std::vector< RolloutResult > results = run_rollouts(pool, first_seed, games, max_steps, 1.0f / tick_rate, beeline);
+	float seconds = std::chrono::duration< float >(std::chrono::steady_clock::now() - before).count();
+
+	static const char *outcome_names[] = { "escaped", "crashed", "out_of_steps" };
+	uint32_t escaped = 0;
+	uint64_t steps = 0;
+	std::cout << "seed,outcome,steps,time,foods_eaten,snake_r\n";
+	for (RolloutResult const &r : results) {
+		std::cout << r.seed << ',' << outcome_names[r.outcome] << ',' << r.steps << ',' << r.time << ',' << r.foods_eaten << ',' << r.snake_r << '\n';
+		if (r.outcome == RolloutResult::Escaped) escaped += 1;
+		steps += r.steps;
+	}
+	std::cout.flush();
+
+	std::cerr << games << " games (" << escaped << " escaped) on " << pool.size() << " threads in " << seconds << "s: "
+	          << (steps / std::max(seconds, 1e-6f)) << " steps/s." << std::endl;
+
+	if (!trace_path.empty()) trace::dump(trace_path); //(workers are idle after run_rollouts)
+
+	return 0;
+}
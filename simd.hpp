@@ -0,0 +1,113 @@
+#pragma once
+
+/*
+ * Compile-time SIMD selection shared by the simulation kernels:
+ *  BSNAKE_AVX2 is defined when building with AVX2 enabled (e.g., -mavx2 or /arch:AVX2),
+ *  otherwise BSNAKE_SSE2 on any x86-64 build; define BSNAKE_NO_SIMD to force scalar code.
+ *
+ * simd::Lanes / simd::Mask wrap one register of floats (8, 4, or 1 wide) with just the
+ *  operations the kernels use, so a kernel can be written once for every width.
+ */
+
+#include <cstdint>
+#include <cmath>
+
+#if defined(BSNAKE_NO_SIMD)
+	//scalar only
+#elif defined(__AVX2__)
+	#define BSNAKE_AVX2
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define BSNAKE_SSE2
+	#include <emmintrin.h>
+#endif
+
+namespace simd {
+
+#if defined(BSNAKE_AVX2)
+
+struct Mask { __m256 v; };
+struct Lanes {
+	static const uint32_t Width = 8;
+	__m256 v;
+	Lanes() = default;
+	Lanes(__m256 v_) : v(v_) { }
+	Lanes(float s) : v(_mm256_set1_ps(s)) { }
+};
+inline Lanes load(float const *p) { return _mm256_load_ps(p); } //p must be 32-byte aligned
+inline Lanes gather(float const *base, uint32_t const *ids) { //base[ids[0]], base[ids[1]], ...
+	return _mm256_i32gather_ps(base, _mm256_loadu_si256(reinterpret_cast< __m256i const * >(ids)), 4);
+}
+inline void store(float *p, Lanes a) { _mm256_store_ps(p, a.v); }
+inline Lanes operator+(Lanes a, Lanes b) { return _mm256_add_ps(a.v, b.v); }
+inline Lanes operator-(Lanes a, Lanes b) { return _mm256_sub_ps(a.v, b.v); }
+inline Lanes operator*(Lanes a, Lanes b) { return _mm256_mul_ps(a.v, b.v); }
+inline Lanes operator/(Lanes a, Lanes b) { return _mm256_div_ps(a.v, b.v); }
+inline Lanes sqrt(Lanes a) { return _mm256_sqrt_ps(a.v); }
+inline Lanes abs(Lanes a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+inline Mask operator<(Lanes a, Lanes b) { return Mask{_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+inline Mask operator>(Lanes a, Lanes b) { return Mask{_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+inline Mask operator&(Mask a, Mask b) { return Mask{_mm256_and_ps(a.v, b.v)}; }
+inline Mask operator|(Mask a, Mask b) { return Mask{_mm256_or_ps(a.v, b.v)}; }
+inline Mask and_not(Mask a, Mask b) { return Mask{_mm256_andnot_ps(b.v, a.v)}; } //a & ~b
+inline Lanes select(Mask m, Lanes a, Lanes b) { return _mm256_blendv_ps(b.v, a.v, m.v); } //m ? a : b
+inline uint32_t bits(Mask m) { return uint32_t(_mm256_movemask_ps(m.v)); }
+
+#elif defined(BSNAKE_SSE2)
+
+struct Mask { __m128 v; };
+struct Lanes {
+	static const uint32_t Width = 4;
+	__m128 v;
+	Lanes() = default;
+	Lanes(__m128 v_) : v(v_) { }
+	Lanes(float s) : v(_mm_set1_ps(s)) { }
+};
+inline Lanes load(float const *p) { return _mm_load_ps(p); } //p must be 16-byte aligned
+inline Lanes gather(float const *base, uint32_t const *ids) { //base[ids[0]], base[ids[1]], ... (SSE2 has no gather instruction)
+	return _mm_setr_ps(base[ids[0]], base[ids[1]], base[ids[2]], base[ids[3]]);
+}
+inline void store(float *p, Lanes a) { _mm_store_ps(p, a.v); }
+inline Lanes operator+(Lanes a, Lanes b) { return _mm_add_ps(a.v, b.v); }
+inline Lanes operator-(Lanes a, Lanes b) { return _mm_sub_ps(a.v, b.v); }
+inline Lanes operator*(Lanes a, Lanes b) { return _mm_mul_ps(a.v, b.v); }
+inline Lanes operator/(Lanes a, Lanes b) { return _mm_div_ps(a.v, b.v); }
+inline Lanes sqrt(Lanes a) { return _mm_sqrt_ps(a.v); }
+inline Lanes abs(Lanes a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+inline Mask operator<(Lanes a, Lanes b) { return Mask{_mm_cmplt_ps(a.v, b.v)}; }
+inline Mask operator>(Lanes a, Lanes b) { return Mask{_mm_cmpgt_ps(a.v, b.v)}; }
+inline Mask operator&(Mask a, Mask b) { return Mask{_mm_and_ps(a.v, b.v)}; }
+inline Mask operator|(Mask a, Mask b) { return Mask{_mm_or_ps(a.v, b.v)}; }
+inline Mask and_not(Mask a, Mask b) { return Mask{_mm_andnot_ps(b.v, a.v)}; } //a & ~b
+inline Lanes select(Mask m, Lanes a, Lanes b) { return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)); } //m ? a : b
+inline uint32_t bits(Mask m) { return uint32_t(_mm_movemask_ps(m.v)); }
+
+#else
+
+struct Mask { bool v; };
+struct Lanes {
+	static const uint32_t Width = 1;
+	float v;
+	Lanes() = default;
+	Lanes(float s) : v(s) { }
+};
+inline Lanes load(float const *p) { return *p; }
+inline Lanes gather(float const *base, uint32_t const *ids) { return base[ids[0]]; }
+inline void store(float *p, Lanes a) { *p = a.v; }
+inline Lanes operator+(Lanes a, Lanes b) { return a.v + b.v; }
+inline Lanes operator-(Lanes a, Lanes b) { return a.v - b.v; }
+inline Lanes operator*(Lanes a, Lanes b) { return a.v * b.v; }
+inline Lanes operator/(Lanes a, Lanes b) { return a.v / b.v; }
+inline Lanes sqrt(Lanes a) { return std::sqrt(a.v); }
+inline Lanes abs(Lanes a) { return std::abs(a.v); }
+inline Mask operator<(Lanes a, Lanes b) { return Mask{a.v < b.v}; }
+inline Mask operator>(Lanes a, Lanes b) { return Mask{a.v > b.v}; }
+inline Mask operator&(Mask a, Mask b) { return Mask{a.v && b.v}; }
+inline Mask operator|(Mask a, Mask b) { return Mask{a.v || b.v}; }
+inline Mask and_not(Mask a, Mask b) { return Mask{a.v && !b.v}; } //a & ~b
+inline Lanes select(Mask m, Lanes a, Lanes b) { return m.v ? a : b; } //m ? a : b
+inline uint32_t bits(Mask m) { return m.v ? 1u : 0u; }
+
+#endif
+
+} //namespace simd